@@ -0,0 +1,388 @@
+#include "BatchMachine.h"
+#include <algorithm>
+#include <chrono>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+constexpr size_t vectorLanes = 4; // int64 values in a 256-bit vector
+
+enum class Arithmetic { Add, Sub, Mul, Less, Equal };
+
+template<Arithmetic op>
+inline int64_t combine(int64_t a, int64_t b) {
+    uint64_t x = static_cast<uint64_t>(a), y = static_cast<uint64_t>(b);
+    if constexpr (op == Arithmetic::Add) return static_cast<int64_t>(x + y);
+    if constexpr (op == Arithmetic::Sub) return static_cast<int64_t>(x - y);
+    if constexpr (op == Arithmetic::Mul) return static_cast<int64_t>(x * y);
+    if constexpr (op == Arithmetic::Less) return a < b;
+    return a == b;
+}
+
+// Sign bit set where the wrapped sum or difference `r` of a and b overflowed
+template<Arithmetic op>
+inline int64_t overflowed(int64_t a, int64_t b, int64_t r) {
+    return op == Arithmetic::Add ? (a ^ r) & (b ^ r) : (a ^ b) & (a ^ r);
+}
+
+#ifdef __AVX2__
+inline __m256i load(const int64_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+inline void store(int64_t *p, __m256i v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+
+// Low 64 bits of the products; AVX2 only multiplies 32-bit halves
+inline __m256i multiply(__m256i a, __m256i b) {
+    __m256i crossed = _mm256_mullo_epi32(a, _mm256_shuffle_epi32(b, 0xB1)); // a.lo * b.hi, a.hi * b.lo
+    __m256i high = _mm256_shuffle_epi32(_mm256_hadd_epi32(crossed, _mm256_setzero_si256()), 0x73);
+    return _mm256_add_epi64(_mm256_mul_epu32(a, b), high);
+}
+
+template<Arithmetic op>
+inline __m256i combine(__m256i a, __m256i b) {
+    if constexpr (op == Arithmetic::Add) return _mm256_add_epi64(a, b);
+    if constexpr (op == Arithmetic::Sub) return _mm256_sub_epi64(a, b);
+    if constexpr (op == Arithmetic::Mul) return multiply(a, b);
+    if constexpr (op == Arithmetic::Less) return _mm256_srli_epi64(_mm256_cmpgt_epi64(b, a), 63);
+    return _mm256_srli_epi64(_mm256_cmpeq_epi64(a, b), 63);
+}
+
+template<Arithmetic op>
+inline __m256i overflowed(__m256i a, __m256i b, __m256i r) {
+    if constexpr (op == Arithmetic::Add) {
+        return _mm256_and_si256(_mm256_xor_si256(a, r), _mm256_xor_si256(b, r));
+    }
+    return _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(a, r));
+}
+#endif
+
+// dst = a op b in the lanes whose mask is -1, or in all lanes without a mask. With
+// `faults`, marks the lanes where an add or subtract overflowed (sign bit set) and
+// returns whether there are any. dst may be a or b.
+template<Arithmetic op>
+bool apply(int64_t *dst, const int64_t *a, const int64_t *b, const int64_t *mask, size_t count,
+           int64_t *faults = nullptr) {
+#ifdef __AVX2__
+    __m256i any = _mm256_setzero_si256();
+    for (size_t i = 0; i < count; i += vectorLanes) {
+        __m256i x = load(a + i), y = load(b + i);
+        __m256i r = combine<op>(x, y);
+        if (faults) {
+            __m256i fault = overflowed<op>(x, y, r);
+            if (mask) fault = _mm256_and_si256(fault, load(mask + i));
+            store(faults + i, fault);
+            any = _mm256_or_si256(any, fault);
+        }
+        store(dst + i, mask ? _mm256_blendv_epi8(load(dst + i), r, load(mask + i)) : r);
+    }
+    return _mm256_movemask_pd(_mm256_castsi256_pd(any)) != 0;
+#else
+    int64_t any = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int64_t x = a[i], y = b[i];
+        int64_t r = combine<op>(x, y);
+        if (faults) {
+            faults[i] = mask ? overflowed<op>(x, y, r) & mask[i] : overflowed<op>(x, y, r);
+            any |= faults[i];
+        }
+        dst[i] = !mask || mask[i] ? r : dst[i];
+    }
+    return any < 0;
+#endif
+}
+
+// dst = value, or dst = *source, in the lanes of `mask` or in all lanes
+void assign(int64_t *dst, const int64_t *source, int64_t value, const int64_t *mask, size_t count) {
+#ifdef __AVX2__
+    __m256i constant = _mm256_set1_epi64x(value);
+    for (size_t i = 0; i < count; i += vectorLanes) {
+        __m256i r = source ? load(source + i) : constant;
+        store(dst + i, mask ? _mm256_blendv_epi8(load(dst + i), r, load(mask + i)) : r);
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+        int64_t r = source ? source[i] : value;
+        dst[i] = !mask || mask[i] ? r : dst[i];
+    }
+#endif
+}
+
+// The state of one BatchMachine::run
+class Batch {
+public:
+    Batch(const Program &program, const vector<size_t> &blockEnd, const vector<const vector<int64_t> *> &inputs,
+          const ExecutionLimits &limits)
+        : program(program), code(program.code), blockEnd(blockEnd), inputs(inputs), limits(limits),
+          lanes(inputs.size()), stride((lanes + vectorLanes - 1) / vectorLanes * vectorLanes),
+          registers(static_cast<size_t>(program.registerCount) * stride, 0), mask(stride, 0), faults(stride, 0),
+          pc(lanes, 0), steps(lanes, 0), readIndex(lanes, 0), live(lanes, 1), liveCount(lanes),
+          results(lanes) {}
+
+    vector<LaneResult> run() {
+        auto deadline = chrono::steady_clock::now() + limits.timeout;
+        uint64_t sinceClock = 0;
+        while (liveCount > 0) {
+            size_t start = gather();
+            sinceClock += execute(start);
+            if (limits.timeout.count() > 0 && sinceClock >= clockInterval) {
+                sinceClock = 0;
+                if (chrono::steady_clock::now() >= deadline) {
+                    for (size_t lane = 0; lane < lanes; ++lane) {
+                        if (live[lane]) retire(lane, LaneResult::Status::TimedOut, 0);
+                    }
+                }
+            }
+        }
+        return move(results);
+    }
+
+private:
+    static constexpr uint64_t clockInterval = 4096;
+
+    const Program &program;
+    const vector<Instruction> &code;
+    const vector<size_t> &blockEnd;
+    const vector<const vector<int64_t> *> &inputs;
+    const ExecutionLimits &limits;
+    size_t lanes;
+    size_t stride; // lanes rounded up to whole vectors
+    vector<int64_t> registers; // register r of lane l at r * stride + l
+    vector<int64_t> mask;      // -1 for the lanes running the current block
+    // Whether no live lane is left out of the group. The vector operations then run
+    // without the mask: finished lanes and the padding compute values nobody reads.
+    bool full = false;
+    size_t first = 0; // the group lies in [first, last); first is a multiple of vectorLanes
+    size_t last = 0;
+    vector<int64_t> faults;
+    vector<size_t> pc;
+    vector<uint64_t> steps; // before the current block
+    vector<size_t> readIndex;
+    vector<char> live;
+    size_t liveCount;
+    uint64_t budget = 0; // steps the current group can take before one of its lanes reaches maxSteps
+    vector<LaneResult> results;
+
+    int64_t *reg(int index) { return registers.data() + static_cast<size_t>(index) * stride; }
+
+    const int64_t *groupMask() const { return full ? nullptr : mask.data() + first; }
+
+    // Selects the live lanes waiting at the lowest instruction; returns that instruction
+    size_t gather() {
+        size_t start = code.size();
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            if (live[lane]) start = min(start, pc[lane]);
+        }
+        budget = UINT64_MAX;
+        size_t members = 0;
+        first = lanes;
+        last = 0;
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            bool member = live[lane] && pc[lane] == start;
+            mask[lane] = member ? -1 : 0;
+            if (!member) continue;
+            members++;
+            first = min(first, lane);
+            last = lane + 1;
+            if (limits.maxSteps > 0) budget = min(budget, limits.maxSteps - steps[lane]);
+        }
+        first = first / vectorLanes * vectorLanes;
+        full = members == liveCount;
+        return start;
+    }
+
+    // Ends a lane; `executed` counts the instructions of the current block it ran
+    void retire(size_t lane, LaneResult::Status status, uint64_t executed, string error = string()) {
+        LaneResult &result = results[lane];
+        result.status = status;
+        result.steps = steps[lane] + executed;
+        result.error = move(error);
+        live[lane] = false;
+        mask[lane] = 0;
+        liveCount--;
+    }
+
+    void fail(size_t lane, const Instruction &instruction, uint64_t executed, const string &message) {
+        retire(lane, LaneResult::Status::RuntimeError, executed,
+               "Runtime error at line " + to_string(instruction.line) + " : " + message);
+    }
+
+    bool anyMasked() const {
+        for (size_t lane = first; lane < last; ++lane) {
+            if (mask[lane]) return true;
+        }
+        return false;
+    }
+
+    // Runs the block at `start` for the gathered lanes up to its jump, halt or end;
+    // returns the number of instructions the group executed
+    uint64_t execute(size_t start) {
+        size_t end = blockEnd[start];
+        bool limited = budget <= end - start;
+        size_t width = (last + vectorLanes - 1) / vectorLanes * vectorLanes - first;
+        uint64_t executed = 0;
+        for (size_t i = start; i <= end; ++i) {
+            if (limited) {
+                for (size_t lane = first; lane < last; ++lane) {
+                    if (mask[lane] && steps[lane] + executed == limits.maxSteps) {
+                        retire(lane, LaneResult::Status::StepLimit, executed,
+                               "Step limit of " + to_string(limits.maxSteps) + " instructions exceeded");
+                    }
+                }
+                if (!anyMasked()) return executed;
+            }
+            executed++;
+            const Instruction &instruction = code[i];
+            int64_t *dst = reg(instruction.dst);
+            const int64_t *a = reg(instruction.a), *b = reg(instruction.b);
+            switch (instruction.op) {
+                case OpCode::Const:
+                    assign(dst + first, nullptr, instruction.value, groupMask(), width);
+                    break;
+                case OpCode::Move:
+                    assign(dst + first, a + first, 0, groupMask(), width);
+                    break;
+                case OpCode::Add:
+                    apply<Arithmetic::Add>(dst + first, a + first, b + first, groupMask(), width);
+                    break;
+                case OpCode::Sub:
+                    apply<Arithmetic::Sub>(dst + first, a + first, b + first, groupMask(), width);
+                    break;
+                case OpCode::Mul:
+                    apply<Arithmetic::Mul>(dst + first, a + first, b + first, groupMask(), width);
+                    break;
+                case OpCode::Less:
+                    apply<Arithmetic::Less>(dst + first, a + first, b + first, groupMask(), width);
+                    break;
+                case OpCode::Equal:
+                    apply<Arithmetic::Equal>(dst + first, a + first, b + first, groupMask(), width);
+                    break;
+                case OpCode::AddChecked:
+                    if (apply<Arithmetic::Add>(dst + first, a + first, b + first, groupMask(), width, faults.data() + first)) {
+                        failOverflows(instruction, executed);
+                    }
+                    break;
+                case OpCode::SubChecked:
+                    if (apply<Arithmetic::Sub>(dst + first, a + first, b + first, groupMask(), width, faults.data() + first)) {
+                        failOverflows(instruction, executed);
+                    }
+                    break;
+                case OpCode::MulChecked:
+                    for (size_t lane = first; lane < last; ++lane) {
+                        if (!mask[lane]) continue;
+                        int64_t product = 0; // not written in place: dst may be an operand
+                        if (__builtin_mul_overflow(a[lane], b[lane], &product)) {
+                            fail(lane, instruction, executed, "Integer overflow");
+                        } else {
+                            dst[lane] = product;
+                        }
+                    }
+                    break;
+                case OpCode::Div:
+                case OpCode::DivChecked:
+                case OpCode::DivUnchecked:
+                    divide(instruction, executed);
+                    break;
+                case OpCode::Read:
+                    for (size_t lane = first; lane < last; ++lane) {
+                        if (!mask[lane]) continue;
+                        const vector<int64_t> &input = *inputs[lane];
+                        if (readIndex[lane] == input.size()) {
+                            fail(lane, instruction, executed,
+                                 "Expected an integer to read into \"" + program.variables[instruction.dst] + "\"");
+                        } else {
+                            dst[lane] = input[readIndex[lane]++];
+                        }
+                    }
+                    break;
+                case OpCode::Write:
+                    for (size_t lane = first; lane < last; ++lane) {
+                        if (mask[lane]) results[lane].output.push_back(a[lane]);
+                    }
+                    break;
+                case OpCode::Jump:
+                    moveTo(static_cast<size_t>(instruction.target), executed);
+                    return executed;
+                case OpCode::JumpIfFalse:
+                    for (size_t lane = first; lane < last; ++lane) {
+                        if (!mask[lane]) continue;
+                        pc[lane] = a[lane] == 0 ? static_cast<size_t>(instruction.target) : i + 1;
+                        steps[lane] += executed;
+                    }
+                    return executed;
+                case OpCode::Halt:
+                    for (size_t lane = first; lane < last; ++lane) {
+                        if (mask[lane]) retire(lane, LaneResult::Status::Finished, executed);
+                    }
+                    return executed;
+            }
+        }
+        moveTo(end + 1, executed);
+        return executed;
+    }
+
+    void moveTo(size_t target, uint64_t executed) {
+        for (size_t lane = first; lane < last; ++lane) {
+            if (!mask[lane]) continue;
+            pc[lane] = target;
+            steps[lane] += executed;
+        }
+    }
+
+    void failOverflows(const Instruction &instruction, uint64_t executed) {
+        for (size_t lane = first; lane < last; ++lane) {
+            if (mask[lane] && faults[lane] < 0) fail(lane, instruction, executed, "Integer overflow");
+        }
+    }
+
+    // No vector division, so lane by lane
+    void divide(const Instruction &instruction, uint64_t executed) {
+        int64_t *dst = reg(instruction.dst);
+        const int64_t *a = reg(instruction.a), *b = reg(instruction.b);
+        for (size_t lane = first; lane < last; ++lane) {
+            if (!mask[lane]) continue;
+            int64_t dividend = a[lane], divisor = b[lane];
+            if (instruction.op == OpCode::DivUnchecked) {
+                dst[lane] = dividend / divisor;
+            } else if (divisor == 0) {
+                fail(lane, instruction, executed, "Division by zero");
+            } else if (divisor != -1) {
+                dst[lane] = dividend / divisor;
+            } else if (instruction.op == OpCode::DivChecked && dividend == INT64_MIN) {
+                fail(lane, instruction, executed, "Integer overflow");
+            } else {
+                dst[lane] = static_cast<int64_t>(0 - static_cast<uint64_t>(dividend));
+            }
+        }
+    }
+};
+
+} // namespace
+
+BatchMachine::BatchMachine(const Program &program) : program(program), blockEnd(program.code.size(), 0) {
+    // A block ends at a jump or halt, or before the next jump target
+    const vector<Instruction> &code = program.code;
+    vector<bool> leader(code.size() + 1, false);
+    for (size_t i = 0; i < code.size(); ++i) {
+        OpCode op = code[i].op;
+        if (op == OpCode::Jump || op == OpCode::JumpIfFalse) leader[static_cast<size_t>(code[i].target)] = true;
+        if (op == OpCode::Jump || op == OpCode::JumpIfFalse || op == OpCode::Halt) leader[i + 1] = true;
+    }
+    size_t end = code.size();
+    for (size_t i = code.size(); i-- > 0;) {
+        if (leader[i + 1]) end = i;
+        blockEnd[i] = end;
+    }
+}
+
+vector<LaneResult> BatchMachine::run(const vector<const vector<int64_t> *> &inputs, const ExecutionLimits &limits) {
+    if (inputs.empty()) return {};
+    Batch batch(program, blockEnd, inputs, limits);
+    return batch.run();
+}
@@ -0,0 +1,46 @@
+#ifndef BATCHMACHINE_H
+#define BATCHMACHINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CodeGenerator.h"
+#include "VirtualMachine.h"
+
+using namespace std;
+
+// How one input of a batch ended
+struct LaneResult {
+    enum class Status {
+        Finished,
+        RuntimeError, // `error` has the message the VirtualMachine would throw
+        StepLimit,
+        TimedOut      // the batch ran out of time with this lane unfinished
+    };
+
+    Status status = Status::Finished;
+    vector<int64_t> output;
+    uint64_t steps = 0; // instructions executed, counted like VirtualMachine::run
+    string error;
+};
+
+// Runs one compiled Program over many inputs at once. Every register holds one
+// value per input (lane), and each instruction is applied to all lanes that are
+// at it, with AVX2 when the build targets it and plain loops otherwise. Lanes
+// that branch differently wait at their jump target: the lanes at the lowest
+// instruction run first, so an if or a repeat loop is left together again.
+// Lanes retire on halt, a runtime error or their step limit; the others go on.
+class BatchMachine {
+public:
+    explicit BatchMachine(const Program &program);
+
+    // One result per input. maxSteps applies to each lane; the timeout to the
+    // whole batch, after which the unfinished lanes are TimedOut.
+    vector<LaneResult> run(const vector<const vector<int64_t> *> &inputs, const ExecutionLimits &limits);
+
+private:
+    const Program &program;
+    vector<size_t> blockEnd; // for each instruction that starts a block, its last instruction
+};
+
+#endif // BATCHMACHINE_H
@@ -0,0 +1,267 @@
+#include "CodeGenerator.h"
+#include "TreeVisitor.h"
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+// Numbers the variables in order of first appearance
+class VariableCollector : public TreeVisitor<VariableCollector> {
+public:
+    unordered_map<string, int> index;
+    vector<string> names;
+
+    void visitAssign(const TreeNode &node) {
+        visitChildren(node);
+        add(node.value);
+    }
+    void visitRead(const TreeNode &node) { add(node.value); }
+    void visitId(const TreeNode &node) { add(node.value); }
+
+private:
+    void add(const string &name) {
+        if (index.emplace(name, static_cast<int>(names.size())).second) names.push_back(name);
+    }
+};
+
+// Constants wrap like the arithmetic does; false when the digits exceed INT64_MAX
+bool parseConstant(const string &digits, int64_t &value) {
+    uint64_t wrapped = 0;
+    bool fits = true;
+    for (char c: digits) {
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        fits = fits && wrapped <= (static_cast<uint64_t>(INT64_MAX) - digit) / 10;
+        wrapped = wrapped * 10 + digit;
+    }
+    value = static_cast<int64_t>(wrapped);
+    return fits;
+}
+
+// Same arithmetic as the VirtualMachine; with `checked`, an overflow is not folded
+// so that it fails at run time
+bool fold(OpKind op, int64_t left, int64_t right, bool checked, int64_t &value) {
+    uint64_t a = static_cast<uint64_t>(left), b = static_cast<uint64_t>(right);
+    switch (op) {
+        case OpKind::Plus:
+            if (checked) return !__builtin_add_overflow(left, right, &value);
+            value = static_cast<int64_t>(a + b);
+            return true;
+        case OpKind::Minus:
+            if (checked) return !__builtin_sub_overflow(left, right, &value);
+            value = static_cast<int64_t>(a - b);
+            return true;
+        case OpKind::Mult:
+            if (checked) return !__builtin_mul_overflow(left, right, &value);
+            value = static_cast<int64_t>(a * b);
+            return true;
+        case OpKind::Div:
+            if (right == 0 || (checked && right == -1 && left == INT64_MIN)) return false;
+            value = right == -1 ? static_cast<int64_t>(0 - a) : left / right;
+            return true;
+        case OpKind::Less:
+            value = left < right;
+            return true;
+        case OpKind::Equal:
+            value = left == right;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Statements return -1; expressions return the register holding their value
+class CodeGenerator : public TreeVisitor<CodeGenerator, int> {
+public:
+    Program program;
+
+    CodeGenerator(const TreeNode &root, bool overflowChecks) : overflowChecks(overflowChecks) {
+        VariableCollector collector;
+        collector.visit(root);
+        variables = move(collector.index);
+        program.variables = move(collector.names);
+        program.registerCount = static_cast<int>(program.variables.size());
+        program.statements.push_back({NodeKind::Seq, root.line, -1, 0, 0});
+    }
+
+    void finish() {
+        emit(OpCode::Halt, 0);
+    }
+
+    int visitSeq(const TreeNode &node) {
+        for (const auto &statement: node.children) {
+            if (statement) visit(*statement);
+        }
+        return -1;
+    }
+
+    int visitIf(const TreeNode &node) {
+        int saved = enter(node);
+        expressionLine = node.line;
+        int test = visit(*node.children[0]);
+        size_t skipThen = emit(OpCode::JumpIfFalse, node.line, 0, test);
+        visit(*node.children[1]);
+        if (node.children.size() > 2) {
+            size_t skipElse = emit(OpCode::Jump, node.line);
+            program.code[skipThen].target = here();
+            visit(*node.children[2]);
+            program.code[skipElse].target = here();
+        } else {
+            program.code[skipThen].target = here();
+        }
+        current = saved;
+        return -1;
+    }
+
+    int visitRepeat(const TreeNode &node) {
+        int saved = enter(node);
+        int self = current;
+        size_t start = program.code.size();
+        visit(*node.children[0]);
+        expressionLine = node.untilLine;
+        int test = visit(*node.children[1]);
+        size_t back = emit(OpCode::JumpIfFalse, node.untilLine, 0, test);
+        program.code[back].target = static_cast<int>(start);
+        program.statements[self].entry = start;
+        program.statements[self].test = back;
+        current = saved;
+        return -1;
+    }
+
+    int visitAssign(const TreeNode &node) {
+        int saved = enter(node);
+        int variable = variables.at(node.value);
+        expressionLine = node.line;
+        int value = visit(*node.children[0]);
+        // The temporary computed last can be written straight into the variable
+        if (value == program.registerCount - 1 && value >= static_cast<int>(program.variables.size()) &&
+            !program.code.empty() && program.code.back().dst == value) {
+            program.code.back().dst = variable;
+            program.registerCount--;
+        } else {
+            emit(OpCode::Move, node.line, variable, value);
+        }
+        current = saved;
+        return -1;
+    }
+
+    int visitRead(const TreeNode &node) {
+        int saved = enter(node);
+        emit(OpCode::Read, node.line, variables.at(node.value));
+        current = saved;
+        return -1;
+    }
+
+    int visitWrite(const TreeNode &node) {
+        int saved = enter(node);
+        expressionLine = node.line;
+        int value = visit(*node.children[0]);
+        emit(OpCode::Write, node.line, 0, value);
+        current = saved;
+        return -1;
+    }
+
+    int visitOp(const TreeNode &node) {
+        int64_t value = 0;
+        if (constantValue(node, value)) return constant(value);
+        int left = visit(*node.children[0]);
+        int right = visit(*node.children[1]);
+        static const OpCode opcodes[] = {OpCode::Halt, OpCode::Less, OpCode::Equal, OpCode::Add,
+                                         OpCode::Sub, OpCode::Mul, OpCode::Div};
+        static const OpCode checkedOpcodes[] = {OpCode::Halt, OpCode::Less, OpCode::Equal, OpCode::AddChecked,
+                                                OpCode::SubChecked, OpCode::MulChecked, OpCode::DivChecked};
+        int result = temporary();
+        int op = static_cast<int>(node.op);
+        emit(overflowChecks ? checkedOpcodes[op] : opcodes[op], expressionLine, result, left, right);
+        return result;
+    }
+
+    int visitConst(const TreeNode &node) {
+        int64_t value = 0;
+        if (!parseConstant(node.value, value) && overflowChecks) {
+            // Checked, a literal above INT64_MAX fails at run time like a sum that gets past it
+            int max = constant(INT64_MAX);
+            int one = constant(1);
+            int result = temporary();
+            emit(OpCode::AddChecked, expressionLine, result, max, one);
+            return result;
+        }
+        return constant(value);
+    }
+
+    int visitId(const TreeNode &node) {
+        return variables.at(node.value);
+    }
+
+private:
+    struct Folded {
+        bool constant;
+        int64_t value;
+    };
+
+    bool overflowChecks;
+    unordered_map<string, int> variables;
+    unordered_map<const TreeNode *, Folded> folded; // per operator node, shared subtrees are folded once
+    int current = 0; // statement being compiled
+    // Line given to expression instructions: that of the statement, or of UNTIL for a
+    // repeat test. Not the node's own, since an interned subtree is shared across lines
+    int expressionLine = 0;
+
+    // Whether an expression only combines constants; a division by zero (or an overflow,
+    // when checked) is left to fail at run time
+    bool constantValue(const TreeNode &node, int64_t &value) {
+        if (node.kind == NodeKind::Const) return parseConstant(node.value, value) || !overflowChecks;
+        if (node.kind != NodeKind::Op) return false;
+        auto found = folded.find(&node);
+        if (found == folded.end()) {
+            int64_t left = 0, right = 0;
+            Folded result{false, 0};
+            if (constantValue(*node.children[0], left) && constantValue(*node.children[1], right)) {
+                result.constant = fold(node.op, left, right, overflowChecks, result.value);
+            }
+            found = folded.emplace(&node, result).first;
+        }
+        value = found->second.value;
+        return found->second.constant;
+    }
+
+    int here() const { return static_cast<int>(program.code.size()); }
+
+    int temporary() { return program.registerCount++; }
+
+    int constant(int64_t value) {
+        int result = temporary();
+        emit(OpCode::Const, expressionLine, result);
+        program.code.back().value = value;
+        return result;
+    }
+
+    size_t emit(OpCode op, int line, int dst = 0, int a = 0, int b = 0) {
+        Instruction instruction;
+        instruction.op = op;
+        instruction.dst = dst;
+        instruction.a = a;
+        instruction.b = b;
+        instruction.line = line;
+        instruction.statement = current;
+        program.code.push_back(instruction);
+        return program.code.size() - 1;
+    }
+
+    // Starts a statement; its parent is the nearest enclosing if or repeat
+    int enter(const TreeNode &node) {
+        int saved = current;
+        current = static_cast<int>(program.statements.size());
+        program.statements.push_back({node.kind, node.line, saved, program.code.size(), 0});
+        return saved;
+    }
+};
+
+} // namespace
+
+Program compileProgram(const TreeNode &root, bool overflowChecks) {
+    CodeGenerator generator(root, overflowChecks);
+    generator.visit(root);
+    generator.finish();
+    return move(generator.program);
+}
@@ -0,0 +1,67 @@
+#ifndef CODEGENERATOR_H
+#define CODEGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TreeNode.h"
+
+using namespace std;
+
+enum class OpCode : unsigned char {
+    Const,       // dst = value
+    Move,        // dst = a
+    Add,         // dst = a + b, wrapping
+    Sub,
+    Mul,
+    Div,         // dst = a / b truncated; error when b is 0
+    AddChecked,  // like Add, Sub and Mul, with an error on overflow
+    SubChecked,
+    MulChecked,
+    DivChecked,  // like Div, with an error on overflow (INT64_MIN / -1)
+    DivUnchecked, // dst = a / b; b is never 0, nor -1 when a can be INT64_MIN
+    Less,        // dst = a < b ? 1 : 0
+    Equal,
+    Read,        // dst = next integer of the input
+    Write,       // print a
+    Jump,        // continue at target
+    JumpIfFalse, // continue at target when a is 0
+    Halt
+};
+
+struct Instruction {
+    OpCode op;
+    int dst = 0;
+    int a = 0;
+    int b = 0;
+    int target = 0;
+    int64_t value = 0;
+    int line = 0;      // source line, for runtime errors
+    int statement = 0; // index in Program::statements that emitted it
+};
+
+// A statement of the source program. Statement 0 is the program itself.
+struct StatementInfo {
+    NodeKind kind;
+    int line;
+    int parent;   // enclosing if/repeat statement, or 0; -1 for the program
+    size_t entry; // first instruction run when the statement starts
+    size_t test;  // repeat only: the JumpIfFalse back to the body
+};
+
+// Three-address code over a flat register file. Registers below
+// variables.size() hold the variables, all starting at 0; the rest are
+// temporaries, each written by exactly one instruction.
+struct Program {
+    vector<Instruction> code;
+    vector<string> variables;
+    int registerCount = 0;
+    vector<StatementInfo> statements;
+};
+
+// With `overflowChecks`, + - * and / compile to the checked instructions and a
+// result that does not fit in 64 bits is a runtime error instead of wrapping.
+Program compileProgram(const TreeNode &root, bool overflowChecks = false);
+
+#endif // CODEGENERATOR_H
@@ -0,0 +1,135 @@
+#include "CompilationSession.h"
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "Scanner.h"
+
+bool scanSource(const std::string &source, std::vector<Token> &tokens, const std::function<bool(int)> &progress)
+{
+    std::istringstream in(source);
+    bool commentState = false;
+    int lineCount = 1;
+    size_t bytesRead = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        std::vector<Token> lineTokens = tokenize(line, lineCount, commentState);
+        tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+        lineCount++;
+        bytesRead += line.size() + 1;
+        int permille = source.empty() ? 1000 : static_cast<int>(std::min<size_t>(1000, bytesRead * 1000 / source.size()));
+        if (progress && !progress(permille))
+            return false;
+    }
+    return true;
+}
+
+bool writeTokenFile(const std::string &path, const std::vector<Token> &tokens)
+{
+    std::ofstream out(path);
+    if (!out.is_open())
+        return false;
+    for (const Token &token : tokens)
+    {
+        out << token.value << "," << token.type << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+CompilationSession::CompilationSession(const QString &filePath, QObject *parent)
+    : QObject(parent), path(filePath)
+{
+    connect(&watcher, &QFileSystemWatcher::fileChanged, this, &CompilationSession::fileChanged);
+}
+
+QString CompilationSession::tokenFilePath() const
+{
+    return QFileInfo(path).path() + "/token_file.txt";
+}
+
+bool CompilationSession::refresh(QString &error)
+{
+    QFileInfo info(path);
+    if (text && info.exists() && info.lastModified() == modified && info.size() == size)
+        return true;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        invalidate();
+        error = "Failed to open input file.";
+        return false;
+    }
+    QByteArray bytes = file.readAll();
+    QByteArray newHash = QCryptographicHash::hash(bytes, QCryptographicHash::Sha1);
+    // Editors that save by replacing the file drop it from the watcher
+    if (!watcher.files().contains(path))
+        watcher.addPath(path);
+
+    if (!text || newHash != hash)
+    {
+        invalidate();
+        hash = newHash;
+        text = std::make_shared<const std::string>(bytes.constData(), static_cast<size_t>(bytes.size()));
+    }
+    modified = info.lastModified();
+    size = info.size();
+    return true;
+}
+
+bool CompilationSession::scan(QString &error)
+{
+    if (cachedTokens)
+        return true;
+    auto tokens = std::make_shared<std::vector<Token>>();
+    try
+    {
+        scanSource(*text, *tokens);
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+        return false;
+    }
+    if (!writeTokenFile(tokenFilePath().toStdString(), *tokens))
+    {
+        error = "Failed to create output file.";
+        return false;
+    }
+    cachedTokens = std::move(tokens);
+    return true;
+}
+
+void CompilationSession::storeTokens(quint64 version, std::shared_ptr<const std::vector<Token>> tokens)
+{
+    if (version == currentVersion)
+        cachedTokens = std::move(tokens);
+}
+
+void CompilationSession::storeSyntaxTree(quint64 version, std::shared_ptr<TreeNode> syntaxTree, const QStringList &issues)
+{
+    if (version != currentVersion)
+        return;
+    cachedTree = std::move(syntaxTree);
+    cachedIssues = issues;
+}
+
+void CompilationSession::fileChanged()
+{
+    QString error;
+    refresh(error);
+}
+
+void CompilationSession::invalidate()
+{
+    currentVersion++;
+    text.reset();
+    cachedTokens.reset();
+    cachedTree.reset();
+    cachedIssues.clear();
+    hash.clear();
+    size = -1;
+}
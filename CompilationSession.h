@@ -0,0 +1,78 @@
+#ifndef COMPILATIONSESSION_H
+#define COMPILATIONSESSION_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Token.h"
+#include "TreeNode.h"
+
+// Scans `source` line by line with its own comment state. `progress` gets the
+// permille scanned after each line and returns false to stop, in which case the
+// result is false. Scanner errors are thrown.
+bool scanSource(const std::string &source, std::vector<Token> &tokens,
+                const std::function<bool(int)> &progress = nullptr);
+
+// One "value,type" line per token
+bool writeTokenFile(const std::string &path, const std::vector<Token> &tokens);
+
+// The file an operation_window works on, read once and shared by its Scan and
+// Parse actions. The text, tokens and syntax tree are cached until the file
+// changes on disk: a QFileSystemWatcher notices edits, and refresh() checks the
+// modification time and size before every use. A changed time with the same
+// content hash keeps the cache. Lives on the UI thread; results computed
+// elsewhere are handed back with the version they were computed for.
+class CompilationSession : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CompilationSession(const QString &filePath, QObject *parent = nullptr);
+
+    // token_file.txt next to the source
+    QString tokenFilePath() const;
+
+    // Brings the cached text up to date with the file; false with `error` set when it cannot be read
+    bool refresh(QString &error);
+
+    // Scans the cached text if that has not happened yet and writes the token file
+    bool scan(QString &error);
+
+    // Increases whenever the cache is dropped
+    quint64 version() const { return currentVersion; }
+
+    std::shared_ptr<const std::string> source() const { return text; }
+    std::shared_ptr<const std::vector<Token>> tokens() const { return cachedTokens; }
+    std::shared_ptr<TreeNode> syntaxTree() const { return cachedTree; }
+    const QStringList &issues() const { return cachedIssues; }
+
+    // Results computed for `version`; dropped when the file has changed since
+    void storeTokens(quint64 version, std::shared_ptr<const std::vector<Token>> tokens);
+    void storeSyntaxTree(quint64 version, std::shared_ptr<TreeNode> syntaxTree, const QStringList &issues);
+
+private slots:
+    void fileChanged();
+
+private:
+    void invalidate();
+
+    QString path;
+    QFileSystemWatcher watcher;
+    QDateTime modified;
+    qint64 size = -1;
+    QByteArray hash;
+    quint64 currentVersion = 0;
+
+    std::shared_ptr<const std::string> text;
+    std::shared_ptr<const std::vector<Token>> cachedTokens;
+    std::shared_ptr<TreeNode> cachedTree;
+    QStringList cachedIssues;
+};
+
+#endif // COMPILATIONSESSION_H
@@ -0,0 +1,288 @@
+#include "DfaScanner.h"
+#include "Scanner.h"
+#include <cstdint>
+
+using namespace std;
+
+namespace {
+
+struct TokenSpec {
+    const char *text;
+    const char *type;
+};
+
+// The fixed tokens of TINY, the same as tokenMap in Scanner.cpp: words of letters
+// are keywords, the rest are symbols of one or two punctuation characters.
+// Numbers, identifiers, whitespace and {comments} are built into the automaton.
+constexpr TokenSpec tokenSpec[] = {
+    {";", "SEMICOLON"}, {"if", "IF"}, {"then", "THEN"}, {"end", "END"}, {"repeat", "REPEAT"},
+    {"until", "UNTIL"}, {":=", "ASSIGN"}, {"read", "READ"}, {"write", "WRITE"},
+    {"<", "LESSTHAN"}, {"=", "EQUAL"}, {"+", "PLUS"}, {"-", "MINUS"},
+    {"*", "MULT"}, {"/", "DIV"}, {"(", "OPENBRACKET"}, {")", "CLOSEDBRACKET"}, {"else", "ELSE"}
+};
+
+constexpr int SPEC_COUNT = sizeof(tokenSpec) / sizeof(tokenSpec[0]);
+constexpr int KEYWORD_SLOTS = 16;
+
+// Byte classes of isspace, ispunct, isdigit and isalpha in the C locale
+constexpr bool isSpaceByte(int c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+constexpr bool isDigitByte(int c) { return c >= '0' && c <= '9'; }
+constexpr bool isAlphaByte(int c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+constexpr bool isPunctByte(int c) {
+    return (c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~');
+}
+
+constexpr int textLength(const char *text) {
+    int n = 0;
+    while (text[n]) ++n;
+    return n;
+}
+
+constexpr bool isKeyword(const char *text) {
+    for (int i = 0; text[i]; ++i) {
+        if (!isAlphaByte(text[i])) return false;
+    }
+    return text[0] != 0;
+}
+
+constexpr unsigned keywordHash(unsigned multiplier, unsigned char first, unsigned char last, size_t length) {
+    return (first * multiplier + last + static_cast<unsigned>(length)) % KEYWORD_SLOTS;
+}
+
+// Scanner states: the class of the word being read, outside and then inside a
+// comment (a word goes on after a comment closes), then one state per
+// two-character symbol whose first character has been seen
+enum State : uint8_t {
+    S_NONE, S_NUMBER, S_IDENTIFIER, S_BAD,
+    S_COMMENT,
+    S_PREFIX = 2 * S_COMMENT
+};
+
+constexpr int countPrefixes() {
+    int count = 0;
+    for (int k = 0; k < SPEC_COUNT; ++k) {
+        if (textLength(tokenSpec[k].text) != 2) continue;
+        bool seen = false;
+        for (int j = 0; j < k; ++j) {
+            seen = seen || (textLength(tokenSpec[j].text) == 2 && tokenSpec[j].text[0] == tokenSpec[k].text[0]);
+        }
+        if (!seen) count++;
+    }
+    return count;
+}
+
+constexpr int STATE_COUNT = S_PREFIX + countPrefixes();
+
+enum Action : uint8_t {
+    A_FLUSH = 1, // the pending word ends before this byte
+    A_BEGIN = 2, // a word starts at this byte
+    A_EMIT = 4,  // `symbol` ends at this byte
+    A_ERROR = 8, // unknown symbol: this byte, or the first one of an unfinished pair
+    A_SPLIT = 16 // a brace inside the pending word, which is then no single substring
+};
+
+struct Transition {
+    uint8_t next;
+    uint8_t action;
+    uint8_t symbol; // tokenSpec index for A_EMIT
+};
+
+struct Automaton {
+    Transition table[STATE_COUNT][256];
+    int length[SPEC_COUNT];
+    int keywordSlot[KEYWORD_SLOTS]; // tokenSpec index, -1 for an empty slot
+    unsigned multiplier;            // of keywordHash, 0 if no perfect one was found
+    bool valid;                     // every spec entry is a keyword or a symbol the automaton can hold
+};
+
+// Class of a word after appending byte `c`
+constexpr uint8_t wordAfter(int word, int c) {
+    if (isDigitByte(c)) return word == S_NONE || word == S_NUMBER ? S_NUMBER : S_BAD;
+    if (isAlphaByte(c)) return word == S_NONE || word == S_IDENTIFIER ? S_IDENTIFIER : S_BAD;
+    return S_BAD;
+}
+
+constexpr Automaton build() {
+    Automaton a{};
+    a.valid = true;
+
+    // Single symbols by byte, and the state after the first byte of a pair
+    int symbolOf[256] = {};
+    int prefixOf[256] = {};
+    for (int c = 0; c < 256; ++c) symbolOf[c] = -1;
+    int prefixes = S_PREFIX;
+    for (int k = 0; k < SPEC_COUNT; ++k) {
+        const char *text = tokenSpec[k].text;
+        int n = textLength(text);
+        a.length[k] = n;
+        if (isKeyword(text)) continue;
+        bool punctuation = true;
+        for (int i = 0; i < n; ++i) {
+            punctuation = punctuation && isPunctByte(text[i]) && text[i] != '{' && text[i] != '}';
+        }
+        unsigned char first = static_cast<unsigned char>(text[0]);
+        if (!punctuation || n < 1 || n > 2) {
+            a.valid = false;
+        } else if (n == 1) {
+            symbolOf[first] = k;
+        } else if (prefixOf[first] == 0) {
+            prefixOf[first] = prefixes++;
+        }
+    }
+    for (int c = 0; c < 256; ++c) {
+        if (symbolOf[c] >= 0 && prefixOf[c] != 0) a.valid = false; // would need lookahead
+    }
+
+    for (int word = S_NONE; word < S_COMMENT; ++word) {
+        uint8_t flush = word != S_NONE ? A_FLUSH : 0;
+        uint8_t split = word != S_NONE ? A_SPLIT : 0;
+        uint8_t begin = word == S_NONE ? A_BEGIN : 0;
+        for (int c = 0; c < 256; ++c) {
+            Transition &outside = a.table[word][c];
+            Transition &inside = a.table[S_COMMENT + word][c];
+            inside = {static_cast<uint8_t>(S_COMMENT + word), 0, 0};
+            if (c == '{') {
+                outside = {static_cast<uint8_t>(S_COMMENT + word), split, 0};
+            } else if (c == '}') {
+                outside = {static_cast<uint8_t>(word), split, 0};
+                inside = {static_cast<uint8_t>(word), 0, 0};
+            } else if (isSpaceByte(c)) {
+                outside = {S_NONE, flush, 0};
+            } else if (prefixOf[c] != 0) {
+                outside = {static_cast<uint8_t>(prefixOf[c]), flush, 0};
+            } else if (symbolOf[c] >= 0) {
+                outside = {S_NONE, static_cast<uint8_t>(flush | A_EMIT), static_cast<uint8_t>(symbolOf[c])};
+            } else if (isPunctByte(c)) {
+                outside = {S_NONE, static_cast<uint8_t>(flush | A_ERROR), 0};
+            } else {
+                outside = {wordAfter(word, c), begin, 0};
+            }
+        }
+    }
+
+    // After the first byte of a pair only a second one may follow, not even a brace
+    for (int state = S_PREFIX; state < STATE_COUNT; ++state) {
+        for (int c = 0; c < 256; ++c) a.table[state][c] = {S_NONE, A_ERROR, 0};
+    }
+    for (int k = 0; k < SPEC_COUNT; ++k) {
+        const char *text = tokenSpec[k].text;
+        if (a.length[k] != 2 || isKeyword(text)) continue;
+        int prefix = prefixOf[static_cast<unsigned char>(text[0])];
+        a.table[prefix][static_cast<unsigned char>(text[1])] = {S_NONE, A_EMIT, static_cast<uint8_t>(k)};
+    }
+
+    // Smallest multiplier that puts every keyword in a slot of its own
+    for (unsigned multiplier = 1; multiplier < 1024 && a.multiplier == 0; ++multiplier) {
+        bool clash = false;
+        for (int slot = 0; slot < KEYWORD_SLOTS; ++slot) a.keywordSlot[slot] = -1;
+        for (int k = 0; k < SPEC_COUNT && !clash; ++k) {
+            const char *text = tokenSpec[k].text;
+            if (!isKeyword(text)) continue;
+            int n = a.length[k];
+            unsigned slot = keywordHash(multiplier, static_cast<unsigned char>(text[0]),
+                                        static_cast<unsigned char>(text[n - 1]), static_cast<size_t>(n));
+            clash = a.keywordSlot[slot] >= 0;
+            a.keywordSlot[slot] = k;
+        }
+        if (!clash) a.multiplier = multiplier;
+    }
+    return a;
+}
+
+constexpr Automaton automaton = build();
+static_assert(automaton.valid, "token spec has a symbol the DFA scanner cannot recognise");
+static_assert(automaton.multiplier != 0, "no perfect hash for the keywords");
+
+// Text of the word in [begin, end): the characters outside braces and comments
+string wordText(const string &line, size_t begin, size_t end, bool split) {
+    if (!split) return line.substr(begin, end - begin);
+    string word;
+    bool comment = false;
+    for (size_t i = begin; i < end; ++i) {
+        char c = line[i];
+        if (c == '{') {
+            comment = true;
+        } else if (c == '}') {
+            comment = false;
+        } else if (!comment) {
+            word += c;
+        }
+    }
+    return word;
+}
+
+const char *wordType(int word, const string &text) {
+    if (word == S_NUMBER) return "NUMBER";
+    unsigned slot = keywordHash(automaton.multiplier, static_cast<unsigned char>(text.front()),
+                                static_cast<unsigned char>(text.back()), text.size());
+    int k = automaton.keywordSlot[slot];
+    if (k >= 0 && text == tokenSpec[k].text) return tokenSpec[k].type;
+    return "IDENTIFIER";
+}
+
+} // namespace
+
+Expected<vector<Token>> tryTokenizeDfa(const string &line, int lineCount, bool &commentState) {
+    vector<Token> tokens;
+    tokens.reserve(line.size() / 4); // about one token in four bytes of code
+    int state = commentState ? S_COMMENT : S_NONE;
+    size_t wordStart = 0;
+    bool split = false;
+
+    for (size_t i = 0; i < line.size(); ++i) {
+        Transition transition = automaton.table[state][static_cast<unsigned char>(line[i])];
+        uint8_t action = transition.action;
+        if (action != 0) {
+            if (action & A_FLUSH) {
+                string word = wordText(line, wordStart, i, split);
+                if (state == S_BAD) {
+                    commentState = false;
+                    return Diagnostic{DiagnosticCode::UnknownWord, lineCount, static_cast<int>(wordStart), word, ""};
+                }
+                const char *type = wordType(state, word);
+                tokens.push_back({move(word), type, lineCount, static_cast<int>(wordStart)});
+            }
+            if (action & A_ERROR) {
+                size_t column = state >= S_PREFIX ? i - 1 : i;
+                commentState = false;
+                return Diagnostic{DiagnosticCode::UnknownSymbol, lineCount, static_cast<int>(column),
+                                  string(1, line[column]), ""};
+            }
+            if (action & A_EMIT) {
+                const TokenSpec &symbol = tokenSpec[transition.symbol];
+                int column = static_cast<int>(i) + 1 - automaton.length[transition.symbol];
+                tokens.push_back({symbol.text, symbol.type, lineCount, column});
+            }
+            if (action & A_BEGIN) {
+                wordStart = i;
+                split = false;
+            }
+            if (action & A_SPLIT) split = true;
+        }
+        state = transition.next;
+    }
+
+    // A pair cut off by the end of the line, or the last word
+    commentState = state >= S_COMMENT && state < S_PREFIX;
+    if (state >= S_PREFIX) {
+        size_t column = line.size() - 1;
+        return Diagnostic{DiagnosticCode::UnknownSymbol, lineCount, static_cast<int>(column),
+                          string(1, line[column]), ""};
+    }
+    int word = state % S_COMMENT;
+    if (word != S_NONE) {
+        string text = wordText(line, wordStart, line.size(), split);
+        if (word == S_BAD) {
+            return Diagnostic{DiagnosticCode::UnknownWord, lineCount, static_cast<int>(wordStart), text, ""};
+        }
+        const char *type = wordType(word, text);
+        tokens.push_back({move(text), type, lineCount, static_cast<int>(wordStart)});
+    }
+    return tokens;
+}
+
+Expected<vector<Token>> tryTokenizeWith(ScannerEngine engine, const string &line, int lineCount,
+                                        bool &commentState) {
+    if (engine == ScannerEngine::Dfa) return tryTokenizeDfa(line, lineCount, commentState);
+    return tryTokenize(line, lineCount, commentState);
+}
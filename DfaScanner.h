@@ -0,0 +1,25 @@
+#ifndef DFASCANNER_H
+#define DFASCANNER_H
+
+#include <string>
+#include <vector>
+#include "Diagnostic.h"
+#include "Token.h"
+
+using namespace std;
+
+// Table-driven alternative to tryTokenize.
+// The DFA transition table and a perfect hash of the keywords are computed at
+// compile time from the token spec declared in DfaScanner.cpp; scanning is one
+// table transition per byte, and gives the same tokens, comment state and
+// diagnostics as the scanner in Scanner.cpp.
+Expected<vector<Token>> tryTokenizeDfa(const string& line, int lineCount, bool& commentState);
+
+enum class ScannerEngine {
+    TokenMap,
+    Dfa
+};
+
+Expected<vector<Token>> tryTokenizeWith(ScannerEngine engine, const string& line, int lineCount, bool& commentState);
+
+#endif // DFASCANNER_H
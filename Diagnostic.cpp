@@ -0,0 +1,36 @@
+#include "Diagnostic.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+string Diagnostic::message() const {
+    string at = "Error at line " + to_string(line);
+    switch (code) {
+        case DiagnosticCode::UnknownWord:
+            return at + "  :  Unknown token \"" + found + "\"";
+        case DiagnosticCode::UnknownSymbol:
+            return at + " : Unknown token \"" + found + "\"";
+        case DiagnosticCode::NoTokens:
+            return "Error: No tokens to parse.";
+        case DiagnosticCode::UnexpectedToken:
+            return at + " : Unexpected token \"" + found + "\", expected \"" + expected + "\"";
+        case DiagnosticCode::InvalidStatement:
+            return at + " : Invalid statement \"" + found + "\"";
+        case DiagnosticCode::InvalidFactor:
+            return at + " : Invalid factor \"" + found + "\"";
+        case DiagnosticCode::Cancelled:
+            return "Parsing cancelled";
+    }
+    return at;
+}
+
+void raiseDiagnostic(const Diagnostic &diagnostic) {
+#ifdef TINY_NO_EXCEPTIONS
+    cerr << diagnostic.message() << endl;
+    abort();
+#else
+    if (diagnostic.code == DiagnosticCode::Cancelled) throw ParseCancelled();
+    throw runtime_error(diagnostic.message());
+#endif
+}
@@ -0,0 +1,71 @@
+#ifndef DIAGNOSTIC_H
+#define DIAGNOSTIC_H
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+
+using namespace std;
+
+enum class DiagnosticCode {
+    UnknownWord,      // a word that is no keyword, number or identifier
+    UnknownSymbol,    // a punctuation character outside the language
+    NoTokens,
+    UnexpectedToken,
+    InvalidStatement,
+    InvalidFactor,
+    Cancelled         // the parse monitor asked to stop
+};
+
+// A scanner or parser error. Only the code, position and offending text are kept;
+// the message is put together when someone asks for it, so rejecting an input
+// costs no more than the copy of a short string.
+struct Diagnostic {
+    DiagnosticCode code = DiagnosticCode::NoTokens;
+    int line = 0;
+    int column = 0;
+    string found;    // the offending word, symbol or token
+    string expected; // token type that was expected, for UnexpectedToken
+
+    // The text the throwing API has always used, e.g. "Error at line 3 : Invalid factor \";\""
+    string message() const;
+};
+
+// Thrown by Parser when its monitor is cancelled
+struct ParseCancelled : runtime_error {
+    ParseCancelled() : runtime_error("Parsing cancelled") {}
+};
+
+// Reports a diagnostic through the throwing API: runtime_error with message(), or
+// ParseCancelled. Built with TINY_NO_EXCEPTIONS, prints the message and aborts
+// instead; the Expected-returning functions never call it. Only the Scanner and
+// the two parsers report through here: the rest of the tree still throws.
+[[noreturn]] void raiseDiagnostic(const Diagnostic &diagnostic);
+
+// Either a value or the Diagnostic that prevented it
+template<typename T>
+class Expected {
+public:
+    Expected(const T &value) : state(in_place_index<0>, value) {}
+    Expected(T &&value) : state(in_place_index<0>, std::move(value)) {}
+    Expected(Diagnostic error) : state(in_place_index<1>, std::move(error)) {}
+
+    bool ok() const { return state.index() == 0; }
+    explicit operator bool() const { return ok(); }
+
+    T &value() { return std::get<0>(state); }
+    const T &value() const { return std::get<0>(state); }
+    const Diagnostic &error() const { return std::get<1>(state); }
+
+    // The value, or the error passed to raiseDiagnostic()
+    T valueOrRaise() && {
+        if (!ok()) raiseDiagnostic(error());
+        return std::move(value());
+    }
+
+private:
+    variant<T, Diagnostic> state;
+};
+
+#endif // DIAGNOSTIC_H
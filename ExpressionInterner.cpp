@@ -0,0 +1,49 @@
+#include "ExpressionInterner.h"
+#include <functional>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// make_shared puts the node and its reference counts in one block
+constexpr size_t controlBlockBytes = 2 * sizeof(long);
+
+size_t nodeBytes(const TreeNode &node) {
+    size_t bytes = sizeof(TreeNode) + controlBlockBytes;
+    if (node.value.capacity() > string().capacity()) bytes += node.value.capacity() + 1;
+    bytes += node.children.capacity() * sizeof(shared_ptr<TreeNode>);
+    return bytes;
+}
+
+} // namespace
+
+size_t ExpressionInterner::Hash::operator()(const shared_ptr<TreeNode> &node) const {
+    size_t seed = hash<string>()(node->value);
+    seed = seed * 31 + static_cast<size_t>(node->kind);
+    seed = seed * 31 + static_cast<size_t>(node->op);
+    for (const auto &child: node->children) seed = seed * 31 + hash<const TreeNode *>()(child.get());
+    return seed;
+}
+
+// Children are interned before their parent, so comparing their addresses is enough
+bool ExpressionInterner::Same::operator()(const shared_ptr<TreeNode> &a, const shared_ptr<TreeNode> &b) const {
+    if (a->kind != b->kind || a->op != b->op || a->value != b->value || a->children.size() != b->children.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a->children.size(); ++i) {
+        if (a->children[i] != b->children[i]) return false;
+    }
+    return true;
+}
+
+shared_ptr<TreeNode> ExpressionInterner::intern(shared_ptr<TreeNode> node) {
+    counts.nodes++;
+    auto inserted = table.insert(node);
+    if (inserted.second) {
+        counts.unique++;
+        return node;
+    }
+    counts.bytesSaved += nodeBytes(*node);
+    return *inserted.first;
+}
@@ -0,0 +1,41 @@
+#ifndef EXPRESSIONINTERNER_H
+#define EXPRESSIONINTERNER_H
+
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include "TreeNode.h"
+
+using namespace std;
+
+struct InternStats {
+    size_t nodes = 0;      // expression nodes the parser built
+    size_t unique = 0;     // nodes kept after interning
+    size_t bytesSaved = 0; // estimated heap bytes of the nodes that were dropped
+};
+
+// Hash-consing of expression subtrees: a node that matches an earlier one in kind,
+// operator, value and (already interned) children is replaced by the earlier one,
+// so repeated expressions share one subtree and the syntax tree becomes a DAG.
+// A shared node keeps the line of its first occurrence; the semantic checks and
+// the code generator take lines from the enclosing statement instead. Not
+// thread-safe; use one per parse.
+class ExpressionInterner {
+public:
+    shared_ptr<TreeNode> intern(shared_ptr<TreeNode> node);
+
+    const InternStats &stats() const { return counts; }
+
+private:
+    struct Hash {
+        size_t operator()(const shared_ptr<TreeNode> &node) const;
+    };
+    struct Same {
+        bool operator()(const shared_ptr<TreeNode> &a, const shared_ptr<TreeNode> &b) const;
+    };
+
+    unordered_set<shared_ptr<TreeNode>, Hash, Same> table;
+    InternStats counts;
+};
+
+#endif // EXPRESSIONINTERNER_H
@@ -0,0 +1,297 @@
+#include "Json.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+class JsonReader {
+public:
+    explicit JsonReader(const string &source) : source(source) {}
+
+    JsonValue document() {
+        JsonValue value = read();
+        skipSpace();
+        if (pos != source.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    // Arrays and objects nested deeper than this are rejected rather than
+    // exhausting the stack of the recursive reader
+    static constexpr int MAX_DEPTH = 512;
+
+    const string &source;
+    size_t pos = 0;
+    int depth = 0;
+
+    [[noreturn]] void fail(const string &what) const {
+        throw runtime_error("Invalid JSON at offset " + to_string(pos) + " : " + what);
+    }
+
+    void skipSpace() {
+        while (pos < source.size() && (source[pos] == ' ' || source[pos] == '\t' ||
+                                       source[pos] == '\n' || source[pos] == '\r')) {
+            pos++;
+        }
+    }
+
+    bool consume(const char *word) {
+        size_t length = char_traits<char>::length(word);
+        if (source.compare(pos, length, word) != 0) return false;
+        pos += length;
+        return true;
+    }
+
+    void expect(char c) {
+        skipSpace();
+        if (pos >= source.size() || source[pos] != c) fail(string("expected '") + c + "'");
+        pos++;
+    }
+
+    JsonValue read() {
+        skipSpace();
+        if (pos >= source.size()) fail("unexpected end");
+        char c = source[pos];
+        if (c == '{' || c == '[') {
+            if (++depth > MAX_DEPTH) fail("too deep");
+            JsonValue value = c == '{' ? readObject() : readArray();
+            depth--;
+            return value;
+        }
+        if (c == '"') return JsonValue(readString());
+        if (consume("true")) return JsonValue(true);
+        if (consume("false")) return JsonValue(false);
+        if (consume("null")) return JsonValue();
+        if (c == '-' || (c >= '0' && c <= '9')) {
+            // strtod alone would take a bare '-' as 0 and a '-' before "inf" or "nan"
+            char digit = c == '-' && pos + 1 < source.size() ? source[pos + 1] : c;
+            if (digit < '0' || digit > '9') fail("bad number");
+            const char *start = source.c_str() + pos;
+            char *end = nullptr;
+            double number = strtod(start, &end);
+            pos += end - start;
+            return JsonValue(number);
+        }
+        fail("unexpected character");
+    }
+
+    JsonValue readObject() {
+        JsonValue object = JsonValue::object();
+        expect('{');
+        skipSpace();
+        if (pos < source.size() && source[pos] == '}') {
+            pos++;
+            return object;
+        }
+        while (true) {
+            skipSpace();
+            string key = readString();
+            expect(':');
+            object.members.emplace_back(move(key), read());
+            skipSpace();
+            if (pos < source.size() && source[pos] == ',') {
+                pos++;
+                continue;
+            }
+            expect('}');
+            return object;
+        }
+    }
+
+    JsonValue readArray() {
+        JsonValue array = JsonValue::array();
+        expect('[');
+        skipSpace();
+        if (pos < source.size() && source[pos] == ']') {
+            pos++;
+            return array;
+        }
+        while (true) {
+            array.items.push_back(read());
+            skipSpace();
+            if (pos < source.size() && source[pos] == ',') {
+                pos++;
+                continue;
+            }
+            expect(']');
+            return array;
+        }
+    }
+
+    unsigned readHex4() {
+        if (pos + 4 > source.size()) fail("bad escape");
+        unsigned value = static_cast<unsigned>(strtoul(source.substr(pos, 4).c_str(), nullptr, 16));
+        pos += 4;
+        return value;
+    }
+
+    static void appendUtf8(string &out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    string readString() {
+        if (pos >= source.size() || source[pos] != '"') fail("expected string");
+        pos++;
+        string out;
+        while (pos < source.size() && source[pos] != '"') {
+            char c = source[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= source.size()) fail("bad escape");
+            char e = source[pos++];
+            switch (e) {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u': {
+                    unsigned code = readHex4();
+                    if (code >= 0xD800 && code < 0xDC00 && consume("\\u")) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (readHex4() - 0xDC00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default: out += e; break;
+            }
+        }
+        if (pos >= source.size()) fail("unterminated string");
+        pos++;
+        return out;
+    }
+};
+
+void dumpString(const string &text, string &out) {
+    out += '"';
+    for (char c: text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+void dumpValue(const JsonValue &value, string &out) {
+    switch (value.type) {
+        case JsonValue::Null:
+            out += "null";
+            break;
+        case JsonValue::Bool:
+            out += value.boolean ? "true" : "false";
+            break;
+        case JsonValue::Number:
+            if (value.number == floor(value.number) && fabs(value.number) < 1e15) {
+                out += to_string(static_cast<long long>(value.number));
+            } else {
+                char number[32];
+                snprintf(number, sizeof(number), "%.17g", value.number);
+                out += number;
+            }
+            break;
+        case JsonValue::String:
+            dumpString(value.text, out);
+            break;
+        case JsonValue::Array:
+            out += '[';
+            for (size_t i = 0; i < value.items.size(); ++i) {
+                if (i > 0) out += ',';
+                dumpValue(value.items[i], out);
+            }
+            out += ']';
+            break;
+        case JsonValue::Object:
+            out += '{';
+            for (size_t i = 0; i < value.members.size(); ++i) {
+                if (i > 0) out += ',';
+                dumpString(value.members[i].first, out);
+                out += ':';
+                dumpValue(value.members[i].second, out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+} // namespace
+
+JsonValue JsonValue::array() {
+    JsonValue value;
+    value.type = Array;
+    return value;
+}
+
+JsonValue JsonValue::object() {
+    JsonValue value;
+    value.type = Object;
+    return value;
+}
+
+const JsonValue &JsonValue::operator[](const string &key) const {
+    static const JsonValue null;
+    for (const auto &member: members) {
+        if (member.first == key) return member.second;
+    }
+    return null;
+}
+
+JsonValue &JsonValue::set(const string &key, JsonValue value) {
+    type = Object;
+    for (auto &member: members) {
+        if (member.first == key) {
+            member.second = move(value);
+            return *this;
+        }
+    }
+    members.emplace_back(key, move(value));
+    return *this;
+}
+
+JsonValue &JsonValue::push(JsonValue value) {
+    type = Array;
+    items.push_back(move(value));
+    return *this;
+}
+
+JsonValue JsonValue::parse(const string &source) {
+    JsonReader reader(source);
+    return reader.document();
+}
+
+string JsonValue::dump() const {
+    string out;
+    dumpValue(*this, out);
+    return out;
+}
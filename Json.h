@@ -0,0 +1,43 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Minimal JSON value, enough for JSON-RPC messages
+struct JsonValue {
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    bool boolean = false;
+    double number = 0;
+    string text;
+    vector<JsonValue> items;
+    vector<pair<string, JsonValue>> members;
+
+    JsonValue() = default;
+    JsonValue(bool value) : type(Bool), boolean(value) {}
+    JsonValue(int value) : type(Number), number(value) {}
+    JsonValue(double value) : type(Number), number(value) {}
+    JsonValue(const char *value) : type(String), text(value) {}
+    JsonValue(string value) : type(String), text(move(value)) {}
+
+    static JsonValue array();
+    static JsonValue object();
+
+    // Member lookup; a missing member reads as null
+    const JsonValue &operator[](const string &key) const;
+    JsonValue &set(const string &key, JsonValue value);
+    JsonValue &push(JsonValue value);
+
+    bool isNull() const { return type == Null; }
+
+    // Throws runtime_error on malformed input
+    static JsonValue parse(const string &source);
+    string dump() const;
+};
+
+#endif // JSON_H
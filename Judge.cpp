@@ -0,0 +1,294 @@
+#include "Judge.h"
+#include "BatchMachine.h"
+#include "Scanner.h"
+#include "Parser.h"
+#include "LoopOptimizer.h"
+#include "PartialEvaluator.h"
+#include "RangeAnalysis.h"
+#include "SemanticAnalyzer.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <memory>
+
+using namespace std;
+
+namespace {
+
+struct Submission {
+    string name;
+    Program program;
+    Verdict verdict = Verdict::AC; // CE or MLE when it cannot run
+    string error;
+    uint64_t evaluatedSteps = 0; // run at compile time, charged to every test
+    size_t prologue = 0;         // instructions standing in for them, not charged
+};
+
+string readFile(const string &path) {
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        throw runtime_error("Error: Could not open input file.");
+    }
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+// Values up to the first word that is not an integer; a program reading further
+// fails at the same read as it would on the text itself
+vector<int64_t> readIntegers(const string &path) {
+    RuntimeInput input(readFile(path));
+    vector<int64_t> values;
+    int64_t value = 0;
+    while (input.next(value)) values.push_back(value);
+    return values;
+}
+
+// Rejections are common in batch grading, so the front end runs without exceptions
+void compileSubmission(const string &path, const JudgeLimits &limits, Submission &submission) {
+    submission.name = filesystem::path(path).filename().string();
+    submission.verdict = Verdict::CE;
+    ifstream in(path);
+    if (!in.is_open()) {
+        submission.error = "Error: Could not open input file.";
+        return;
+    }
+    // Own comment state: submissions compile concurrently
+    bool commentState = false;
+    int lineCount = 1;
+    string line;
+    vector<Token> tokens;
+    while (getline(in, line)) {
+        Expected<vector<Token>> lineTokens = tryTokenize(line, lineCount++, commentState);
+        if (!lineTokens) {
+            submission.error = lineTokens.error().message();
+            return;
+        }
+        tokens.insert(tokens.end(), lineTokens.value().begin(), lineTokens.value().end());
+    }
+    Parser parser(move(tokens));
+    Expected<shared_ptr<TreeNode>> syntaxTree = parser.tryParse();
+    if (!syntaxTree) {
+        submission.error = syntaxTree.error().message();
+        return;
+    }
+    for (const SemanticIssue &issue: checkSemantics(*syntaxTree.value())) {
+        if (issue.error) {
+            submission.error = issue.message;
+            return;
+        }
+    }
+    submission.program = compileProgram(*syntaxTree.value(), limits.overflowChecks);
+    if (limits.rangeAnalysis) removeRedundantChecks(submission.program);
+    if (limits.loopOptimizations) optimizeLoops(submission.program);
+    if (limits.partialEvaluationSteps > 0) {
+        // The prefix is part of every test's run, so it stays within a test's limits
+        uint64_t steps = limits.partialEvaluationSteps;
+        if (limits.execution.maxSteps > 0) steps = min(steps, limits.execution.maxSteps);
+        PartialEvaluationStats evaluation = partialEvaluate(submission.program, steps, limits.execution.timeout);
+        submission.evaluatedSteps = evaluation.steps;
+        submission.prologue = evaluation.prologue;
+    }
+    submission.verdict = Verdict::AC;
+
+    size_t variables = submission.program.variables.size();
+    if (limits.maxVariables > 0 && variables > limits.maxVariables) {
+        submission.verdict = Verdict::MLE;
+        submission.error = to_string(variables) + " variables, limit is " + to_string(limits.maxVariables);
+    }
+}
+
+// Values above which a batch runs its tests one at a time instead: registers times lanes
+constexpr size_t maxBatchValues = size_t(1) << 22;
+
+// Limits for a run of the compiled program: the compile-time steps are used up,
+// the prologue that replaced them is free
+ExecutionLimits runLimits(const Submission &submission, const JudgeLimits &limits) {
+    ExecutionLimits execution = limits.execution;
+    if (execution.maxSteps > 0) execution.maxSteps = execution.maxSteps - submission.evaluatedSteps + submission.prologue;
+    return execution;
+}
+
+// Reports the steps of a run under runLimits as those of the original program
+void chargeSteps(const Submission &submission, const JudgeLimits &limits, JudgeResult &result) {
+    if (submission.prologue == 0) return;
+    result.steps = max<uint64_t>(result.steps, submission.prologue) - submission.prologue + submission.evaluatedSteps;
+    if (result.verdict == Verdict::SLE) {
+        result.detail = "Step limit of " + to_string(limits.execution.maxSteps) + " instructions exceeded";
+    }
+}
+
+// Turns an accepted run into WA when `output` differs from the expected values
+void checkOutput(const vector<int64_t> &output, const TestCase &test, JudgeResult &result) {
+    auto mismatch = std::mismatch(output.begin(), output.end(), test.expected.begin(), test.expected.end());
+    if (mismatch.first == output.end() && mismatch.second == test.expected.end()) return;
+    result.verdict = Verdict::WA;
+    size_t index = static_cast<size_t>(mismatch.first - output.begin());
+    if (mismatch.first == output.end()) {
+        result.detail = "output ends after " + to_string(index) + " of " + to_string(test.expected.size()) + " values";
+    } else if (mismatch.second == test.expected.end()) {
+        result.detail = "more than the " + to_string(test.expected.size()) + " expected values";
+    } else {
+        result.detail = "value " + to_string(index + 1) + " is " + to_string(*mismatch.first) + ", expected " +
+                        to_string(*mismatch.second);
+    }
+}
+
+void runJob(const Submission &submission, const TestCase &test, const JudgeLimits &limits, JudgeResult &result) {
+    result.submission = submission.name;
+    result.test = test.name;
+    result.milliseconds = 0;
+    result.steps = 0;
+    if (submission.verdict != Verdict::AC) {
+        result.verdict = submission.verdict;
+        result.detail = submission.error;
+        return;
+    }
+
+    VirtualMachine machine(submission.program);
+    RuntimeInput input(test.input);
+    vector<int64_t> output;
+    auto start = chrono::steady_clock::now();
+    try {
+        RuntimeOutput writer(output);
+        machine.run(input, writer, runLimits(submission, limits), result.steps);
+        result.verdict = Verdict::AC;
+    } catch (const LimitExceeded &e) {
+        result.verdict = e.timedOut ? Verdict::TLE : Verdict::SLE;
+        result.detail = e.what();
+    } catch (const RuntimeError &e) {
+        result.verdict = Verdict::RE;
+        result.detail = e.what();
+    }
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    result.milliseconds = elapsed.count();
+    chargeSteps(submission, limits, result);
+    if (result.verdict == Verdict::AC) checkOutput(output, test, result);
+}
+
+// Runs `count` tests from `first` on one BatchMachine. Lanes that run out of time are
+// run again on their own, so a test that never ends does not decide the others.
+void runBatch(const Submission &submission, const vector<TestCase> &tests, size_t first, size_t count,
+              const JudgeLimits &limits, JudgeResult *results) {
+    if (submission.verdict != Verdict::AC ||
+        static_cast<size_t>(submission.program.registerCount) * count > maxBatchValues) {
+        for (size_t k = 0; k < count; ++k) runJob(submission, tests[first + k], limits, results[k]);
+        return;
+    }
+
+    vector<const vector<int64_t> *> inputs;
+    for (size_t k = 0; k < count; ++k) inputs.push_back(&tests[first + k].input);
+    BatchMachine machine(submission.program);
+    auto start = chrono::steady_clock::now();
+    vector<LaneResult> lanes = machine.run(inputs, runLimits(submission, limits));
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    for (size_t k = 0; k < count; ++k) {
+        const TestCase &test = tests[first + k];
+        LaneResult &lane = lanes[k];
+        JudgeResult &result = results[k];
+        if (lane.status == LaneResult::Status::TimedOut) {
+            runJob(submission, test, limits, result);
+            continue;
+        }
+        result.submission = submission.name;
+        result.test = test.name;
+        result.milliseconds = elapsed.count() / static_cast<double>(count);
+        result.steps = lane.steps;
+        result.detail = move(lane.error);
+        switch (lane.status) {
+            case LaneResult::Status::Finished:
+                result.verdict = Verdict::AC;
+                checkOutput(lane.output, test, result);
+                break;
+            case LaneResult::Status::RuntimeError:
+                result.verdict = Verdict::RE;
+                break;
+            default:
+                result.verdict = Verdict::SLE;
+                break;
+        }
+        chargeSteps(submission, limits, result);
+    }
+}
+
+} // namespace
+
+const char *verdictName(Verdict verdict) {
+    static const char *const names[] = {"AC", "WA", "TLE", "SLE", "MLE", "RE", "CE"};
+    return names[static_cast<int>(verdict)];
+}
+
+vector<TestCase> loadTestCases(const string &directory) {
+    vector<TestCase> tests;
+    for (const auto &entry: filesystem::directory_iterator(directory)) {
+        if (!entry.is_regular_file() || entry.path().extension() != ".in") continue;
+        filesystem::path expected = entry.path();
+        expected.replace_extension(".out");
+        if (!filesystem::exists(expected)) {
+            throw runtime_error("Error: No expected output " + expected.string());
+        }
+        tests.push_back({entry.path().stem().string(), readIntegers(entry.path().string()),
+                         readIntegers(expected.string())});
+    }
+    sort(tests.begin(), tests.end(), [](const TestCase &a, const TestCase &b) { return a.name < b.name; });
+    return tests;
+}
+
+vector<JudgeResult> judgeSubmissions(const vector<string> &submissionFiles, const vector<TestCase> &tests,
+                                     const JudgeLimits &limits, unsigned threadCount) {
+    WorkStealingPool pool(threadCount);
+
+    vector<Submission> submissions(submissionFiles.size());
+    pool.run(submissions.size(), [&](size_t i) {
+        compileSubmission(submissionFiles[i], limits, submissions[i]);
+    });
+
+    vector<JudgeResult> results(submissions.size() * tests.size());
+    if (limits.batchLanes == 0) {
+        pool.run(results.size(), [&](size_t job) {
+            size_t submission = job / tests.size();
+            runJob(submissions[submission], tests[job % tests.size()], limits, results[job]);
+        });
+        return results;
+    }
+
+    size_t batches = (tests.size() + limits.batchLanes - 1) / limits.batchLanes;
+    pool.run(submissions.size() * batches, [&](size_t job) {
+        size_t submission = job / batches;
+        size_t first = job % batches * limits.batchLanes;
+        size_t count = min(limits.batchLanes, tests.size() - first);
+        runBatch(submissions[submission], tests, first, count, limits,
+                 results.data() + submission * tests.size() + first);
+    });
+    return results;
+}
+
+void writeJudgeReport(const vector<JudgeResult> &results, ostream &out) {
+    size_t submissionWidth = 10;
+    size_t testWidth = 4;
+    for (const JudgeResult &result: results) {
+        submissionWidth = max(submissionWidth, result.submission.size());
+        testWidth = max(testWidth, result.test.size());
+    }
+
+    out << left << setw(static_cast<int>(submissionWidth) + 2) << "submission" << setw(static_cast<int>(testWidth) + 2)
+        << "test" << setw(9) << "verdict" << right << setw(10) << "ms" << setw(14) << "steps" << "  detail\n";
+    size_t counts[7] = {};
+    out << fixed << setprecision(3);
+    for (const JudgeResult &result: results) {
+        counts[static_cast<int>(result.verdict)]++;
+        out << left << setw(static_cast<int>(submissionWidth) + 2) << result.submission
+            << setw(static_cast<int>(testWidth) + 2) << result.test << setw(9) << verdictName(result.verdict)
+            << right << setw(10) << result.milliseconds << setw(14) << result.steps;
+        if (!result.detail.empty()) out << "  " << result.detail;
+        out << '\n';
+    }
+
+    out << '\n';
+    for (int v = 0; v < 7; ++v) {
+        out << verdictName(static_cast<Verdict>(v)) << ' ' << counts[v] << (v < 6 ? "  " : "\n");
+    }
+}
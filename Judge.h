@@ -0,0 +1,62 @@
+#ifndef JUDGE_H
+#define JUDGE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "VirtualMachine.h"
+
+using namespace std;
+
+enum class Verdict {
+    AC,  // accepted
+    WA,  // wrong answer
+    TLE, // wall-clock timeout
+    SLE, // instruction budget used up
+    MLE, // more variables than allowed
+    RE,  // runtime error
+    CE   // scanner, parser or type error
+};
+
+const char *verdictName(Verdict verdict);
+
+struct JudgeLimits {
+    ExecutionLimits execution;
+    size_t maxVariables = 0; // 0 for no limit
+    bool loopOptimizations = true;
+    bool overflowChecks = false; // overflow is a runtime error (RE) instead of wrapping
+    bool rangeAnalysis = true;
+    uint64_t partialEvaluationSteps = 0; // instructions run once at compile time, 0 for none
+    size_t batchLanes = 0; // tests run together on a BatchMachine, 0 to run each on its own
+};
+
+// Integers a test feeds to read statements and expects from write statements
+struct TestCase {
+    string name;
+    vector<int64_t> input;
+    vector<int64_t> expected;
+};
+
+struct JudgeResult {
+    string submission;
+    string test;
+    Verdict verdict;
+    double milliseconds; // run time, 0 when the program did not run
+    uint64_t steps;
+    string detail;
+};
+
+// Every <name>.in in `directory` with its <name>.out, ordered by name
+vector<TestCase> loadTestCases(const string &directory);
+
+// Compiles each submission once, then runs every (submission, test) pair on a
+// WorkStealingPool, or with batchLanes every (submission, batch of tests) pair.
+// Results are ordered by submission, then test.
+vector<JudgeResult> judgeSubmissions(const vector<string> &submissionFiles, const vector<TestCase> &tests,
+                                     const JudgeLimits &limits, unsigned threadCount = 0);
+
+// One line per job, then the number of jobs per verdict
+void writeJudgeReport(const vector<JudgeResult> &results, ostream &out);
+
+#endif // JUDGE_H
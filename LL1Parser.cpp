@@ -0,0 +1,343 @@
+#include "LL1Parser.h"
+#include "Parser.h"
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+// Grammar symbols: terminals, then nonterminals, then semantic actions
+enum Symbol : int {
+    T_IF, T_THEN, T_ELSE, T_END, T_REPEAT, T_UNTIL, T_IDENTIFIER, T_ASSIGN, T_READ, T_WRITE,
+    T_LESSTHAN, T_EQUAL, T_PLUS, T_MINUS, T_MULT, T_DIV, T_OPENBRACKET, T_CLOSEDBRACKET,
+    T_NUMBER, T_SEMICOLON, T_UNKNOWN, T_EOF,
+    TERMINAL_COUNT,
+
+    N_PROGRAM = TERMINAL_COUNT, N_STMT_SEQUENCE, N_STMT_TAIL, N_STATEMENT, N_IF_STMT, N_ELSE_PART,
+    N_REPEAT_STMT, N_ASSIGN_STMT, N_READ_STMT, N_WRITE_STMT, N_EXP, N_EXP_TAIL, N_COMPARISON_OP,
+    N_SIMPLE_EXP, N_SIMPLE_EXP_TAIL, N_ADDOP, N_TERM, N_TERM_TAIL, N_MULOP, N_FACTOR,
+    SYMBOL_END,
+
+    A_SEQ = SYMBOL_END, // push a statement sequence node
+    A_IF,              // push an "if" node
+    A_REPEAT,          // push a "repeat" node
+    A_UNTIL,           // record the line of UNTIL on the "repeat" node on top
+    A_ASSIGN,          // push an "assign" node named by the last matched token
+    A_READ,            // push a "read" node named by the last matched token
+    A_WRITE,           // push a "write" node
+    A_OP,              // push an "op" node for the last matched operator
+    A_CONST,           // push a "Const" leaf
+    A_ID,              // push an "id" leaf
+    A_CHILD,           // pop a node and append it to the children of the new top
+    A_BINARY           // pop right, op and left; push op with both operands
+};
+
+constexpr int NONTERMINAL_COUNT = SYMBOL_END - TERMINAL_COUNT;
+constexpr int MAX_RHS = 10;
+
+struct Production {
+    int lhs;
+    int length;
+    int rhs[MAX_RHS];
+};
+
+// TINY grammar in LL(1) form, with semantic actions that build the syntax tree
+constexpr Production grammar[] = {
+    {N_PROGRAM, 1, {N_STMT_SEQUENCE}},
+    {N_STMT_SEQUENCE, 4, {A_SEQ, N_STATEMENT, A_CHILD, N_STMT_TAIL}},
+    {N_STMT_TAIL, 4, {T_SEMICOLON, N_STATEMENT, A_CHILD, N_STMT_TAIL}},
+    {N_STMT_TAIL, 0, {}},
+    {N_STATEMENT, 1, {N_IF_STMT}},
+    {N_STATEMENT, 1, {N_REPEAT_STMT}},
+    {N_STATEMENT, 1, {N_ASSIGN_STMT}},
+    {N_STATEMENT, 1, {N_READ_STMT}},
+    {N_STATEMENT, 1, {N_WRITE_STMT}},
+    {N_IF_STMT, 9, {T_IF, A_IF, N_EXP, A_CHILD, T_THEN, N_STMT_SEQUENCE, A_CHILD, N_ELSE_PART, T_END}},
+    {N_ELSE_PART, 3, {T_ELSE, N_STMT_SEQUENCE, A_CHILD}},
+    {N_ELSE_PART, 0, {}},
+    {N_REPEAT_STMT, 8, {T_REPEAT, A_REPEAT, N_STMT_SEQUENCE, A_CHILD, T_UNTIL, A_UNTIL, N_EXP, A_CHILD}},
+    {N_ASSIGN_STMT, 5, {T_IDENTIFIER, A_ASSIGN, T_ASSIGN, N_EXP, A_CHILD}},
+    {N_READ_STMT, 3, {T_READ, T_IDENTIFIER, A_READ}},
+    {N_WRITE_STMT, 4, {T_WRITE, A_WRITE, N_EXP, A_CHILD}},
+    {N_EXP, 2, {N_SIMPLE_EXP, N_EXP_TAIL}},
+    {N_EXP_TAIL, 4, {N_COMPARISON_OP, A_OP, N_SIMPLE_EXP, A_BINARY}},
+    {N_EXP_TAIL, 0, {}},
+    {N_COMPARISON_OP, 1, {T_LESSTHAN}},
+    {N_COMPARISON_OP, 1, {T_EQUAL}},
+    {N_SIMPLE_EXP, 2, {N_TERM, N_SIMPLE_EXP_TAIL}},
+    {N_SIMPLE_EXP_TAIL, 5, {N_ADDOP, A_OP, N_TERM, A_BINARY, N_SIMPLE_EXP_TAIL}},
+    {N_SIMPLE_EXP_TAIL, 0, {}},
+    {N_ADDOP, 1, {T_PLUS}},
+    {N_ADDOP, 1, {T_MINUS}},
+    {N_TERM, 2, {N_FACTOR, N_TERM_TAIL}},
+    {N_TERM_TAIL, 5, {N_MULOP, A_OP, N_FACTOR, A_BINARY, N_TERM_TAIL}},
+    {N_TERM_TAIL, 0, {}},
+    {N_MULOP, 1, {T_MULT}},
+    {N_MULOP, 1, {T_DIV}},
+    {N_FACTOR, 3, {T_OPENBRACKET, N_EXP, T_CLOSEDBRACKET}},
+    {N_FACTOR, 2, {T_NUMBER, A_CONST}},
+    {N_FACTOR, 2, {T_IDENTIFIER, A_ID}},
+};
+
+constexpr int PRODUCTION_COUNT = sizeof(grammar) / sizeof(grammar[0]);
+
+struct Analysis {
+    bool nullable[NONTERMINAL_COUNT];
+    uint32_t first[NONTERMINAL_COUNT];
+    uint32_t follow[NONTERMINAL_COUNT];
+    int table[NONTERMINAL_COUNT][TERMINAL_COUNT];
+    int fallback[NONTERMINAL_COUNT]; // production used when the table has no entry
+    bool conflict;
+};
+
+constexpr bool isTerminal(int symbol) { return symbol < TERMINAL_COUNT; }
+constexpr bool isNonterminal(int symbol) { return symbol >= TERMINAL_COUNT && symbol < SYMBOL_END; }
+
+// FIRST set of rhs[from..length), clearing `nullable` if the sequence cannot derive epsilon
+constexpr uint32_t firstOf(const Analysis &a, const Production &p, int from, bool &nullable) {
+    uint32_t set = 0;
+    nullable = true;
+    for (int i = from; i < p.length; ++i) {
+        int symbol = p.rhs[i];
+        if (isTerminal(symbol)) {
+            set |= 1u << symbol;
+            nullable = false;
+            break;
+        }
+        if (isNonterminal(symbol)) {
+            set |= a.first[symbol - TERMINAL_COUNT];
+            if (!a.nullable[symbol - TERMINAL_COUNT]) {
+                nullable = false;
+                break;
+            }
+        }
+    }
+    return set;
+}
+
+constexpr Analysis analyse() {
+    Analysis a{};
+
+    // Nullable and FIRST sets
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const Production &p: grammar) {
+            int lhs = p.lhs - TERMINAL_COUNT;
+            bool nullable = true;
+            uint32_t first = firstOf(a, p, 0, nullable);
+            if ((a.first[lhs] | first) != a.first[lhs]) {
+                a.first[lhs] |= first;
+                changed = true;
+            }
+            if (nullable && !a.nullable[lhs]) {
+                a.nullable[lhs] = true;
+                changed = true;
+            }
+        }
+    }
+
+    // FOLLOW sets
+    a.follow[N_PROGRAM - TERMINAL_COUNT] = 1u << T_EOF;
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const Production &p: grammar) {
+            for (int i = 0; i < p.length; ++i) {
+                if (!isNonterminal(p.rhs[i])) continue;
+                int symbol = p.rhs[i] - TERMINAL_COUNT;
+                bool restNullable = true;
+                uint32_t follow = firstOf(a, p, i + 1, restNullable);
+                if (restNullable) follow |= a.follow[p.lhs - TERMINAL_COUNT];
+                if ((a.follow[symbol] | follow) != a.follow[symbol]) {
+                    a.follow[symbol] |= follow;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Parse table
+    int alternatives[NONTERMINAL_COUNT] = {};
+    for (int n = 0; n < NONTERMINAL_COUNT; ++n) {
+        a.fallback[n] = -1;
+        for (int t = 0; t < TERMINAL_COUNT; ++t) a.table[n][t] = -1;
+    }
+    for (int k = 0; k < PRODUCTION_COUNT; ++k) {
+        const Production &p = grammar[k];
+        int lhs = p.lhs - TERMINAL_COUNT;
+        bool nullable = true;
+        uint32_t select = firstOf(a, p, 0, nullable);
+        if (nullable) {
+            select |= a.follow[lhs];
+            a.fallback[lhs] = k;
+        }
+        for (int t = 0; t < TERMINAL_COUNT; ++t) {
+            if (!(select & (1u << t))) continue;
+            if (a.table[lhs][t] >= 0) a.conflict = true;
+            a.table[lhs][t] = k;
+        }
+        alternatives[lhs]++;
+    }
+
+    // Like the loops in Parser, a nullable rule defaults to epsilon and a rule with a
+    // single production is always entered; only real choices report an error.
+    for (int k = 0; k < PRODUCTION_COUNT; ++k) {
+        int lhs = grammar[k].lhs - TERMINAL_COUNT;
+        if (alternatives[lhs] == 1) a.fallback[lhs] = k;
+    }
+    return a;
+}
+
+constexpr Analysis analysis = analyse();
+static_assert(!analysis.conflict, "TINY grammar is not LL(1)");
+
+const unordered_map<string, int> terminalMap = {
+    {"IF", T_IF}, {"THEN", T_THEN}, {"ELSE", T_ELSE}, {"END", T_END}, {"REPEAT", T_REPEAT},
+    {"UNTIL", T_UNTIL}, {"IDENTIFIER", T_IDENTIFIER}, {"ASSIGN", T_ASSIGN}, {"READ", T_READ},
+    {"WRITE", T_WRITE}, {"LESSTHAN", T_LESSTHAN}, {"EQUAL", T_EQUAL}, {"PLUS", T_PLUS},
+    {"MINUS", T_MINUS}, {"MULT", T_MULT}, {"DIV", T_DIV}, {"OPENBRACKET", T_OPENBRACKET},
+    {"CLOSEDBRACKET", T_CLOSEDBRACKET}, {"NUMBER", T_NUMBER}, {"SEMICOLON", T_SEMICOLON}
+};
+
+const char *terminalNames[TERMINAL_COUNT] = {
+    "IF", "THEN", "ELSE", "END", "REPEAT", "UNTIL", "IDENTIFIER", "ASSIGN", "READ", "WRITE",
+    "LESSTHAN", "EQUAL", "PLUS", "MINUS", "MULT", "DIV", "OPENBRACKET", "CLOSEDBRACKET",
+    "NUMBER", "SEMICOLON", "UNKNOWN", "EOF"
+};
+
+} // namespace
+
+LL1Parser::LL1Parser(const std::vector<Token>& tokens) : tokens(tokens) {
+    terminals.reserve(tokens.size() + 1);
+    for (const Token &token: tokens) {
+        auto it = terminalMap.find(token.type);
+        terminals.push_back(it != terminalMap.end() ? it->second : T_UNKNOWN);
+    }
+    terminals.push_back(T_EOF);
+}
+
+// Past the end of input, errors are reported against the last token as Parser does.
+// Only called once tokens is known not to be empty
+const Token& LL1Parser::tokenAt(size_t index) const {
+    return tokens[index < tokens.size() ? index : tokens.size() - 1];
+}
+
+// The Diagnostic Parser gives for the same input when `symbol` cannot be matched
+Diagnostic LL1Parser::error(int symbol, size_t index) const {
+    const Token &token = tokenAt(index);
+    if (symbol == N_STATEMENT) {
+        return Diagnostic{DiagnosticCode::InvalidStatement, token.line, token.column, token.value, ""};
+    }
+    if (symbol == N_FACTOR) {
+        return Diagnostic{DiagnosticCode::InvalidFactor, token.line, token.column, token.value, ""};
+    }
+    string expected = isTerminal(symbol) ? terminalNames[symbol] : "statement";
+    int line = tokenAt(index > 0 ? index - 1 : 0).line;
+    return Diagnostic{DiagnosticCode::UnexpectedToken, line, 0, token.type, expected};
+}
+
+shared_ptr<TreeNode> LL1Parser::parse() {
+    return tryParse().valueOrRaise();
+}
+
+Expected<shared_ptr<TreeNode>> LL1Parser::tryParse() {
+    if (tokens.empty()) return Diagnostic{DiagnosticCode::NoTokens, 0, 0, "", ""};
+    vector<int> stack = {N_PROGRAM};
+    vector<shared_ptr<TreeNode>> nodes;
+    size_t index = 0;
+
+    while (!stack.empty()) {
+        int symbol = stack.back();
+        stack.pop_back();
+        int lookahead = terminals[index];
+
+        if (isTerminal(symbol)) {
+            if (symbol != lookahead) return error(symbol, index);
+            ++index;
+            continue;
+        }
+
+        if (isNonterminal(symbol)) {
+            int nonterminal = symbol - TERMINAL_COUNT;
+            int k = analysis.table[nonterminal][lookahead];
+            if (k < 0) k = analysis.fallback[nonterminal];
+            if (k < 0) return error(symbol, index);
+            const Production &p = grammar[k];
+            for (int i = p.length; i-- > 0;) {
+                stack.push_back(p.rhs[i]);
+            }
+            continue;
+        }
+
+        // Nodes take the line of the token just matched; a sequence starts at the lookahead
+        const Token &last = tokenAt(index > 0 ? index - 1 : 0);
+        const string &matched = last.value;
+        switch (symbol) {
+            case A_SEQ:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Seq));
+                nodes.back()->line = tokenAt(index).line;
+                break;
+            case A_IF:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::If));
+                nodes.back()->line = last.line;
+                break;
+            case A_REPEAT:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Repeat));
+                nodes.back()->line = last.line;
+                break;
+            case A_UNTIL:
+                nodes.back()->untilLine = last.line;
+                break;
+            case A_ASSIGN:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Assign, matched));
+                nodes.back()->line = last.line;
+                break;
+            case A_READ:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Read, matched));
+                nodes.back()->line = tokenAt(index - 2).line; // the READ keyword
+                break;
+            case A_WRITE:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Write));
+                nodes.back()->line = last.line;
+                break;
+            case A_OP:
+                nodes.push_back(std::make_shared<TreeNode>(opFromToken(last.type)));
+                nodes.back()->line = last.line;
+                break;
+            case A_CONST:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Const, matched));
+                nodes.back()->line = last.line;
+                break;
+            case A_ID:
+                nodes.push_back(std::make_shared<TreeNode>(NodeKind::Id, matched));
+                nodes.back()->line = last.line;
+                break;
+            case A_CHILD: {
+                auto child = std::move(nodes.back());
+                nodes.pop_back();
+                nodes.back()->children.push_back(std::move(child));
+                break;
+            }
+            case A_BINARY: {
+                auto right = std::move(nodes.back());
+                nodes.pop_back();
+                auto op = std::move(nodes.back());
+                nodes.pop_back();
+                op->children.push_back(std::move(nodes.back()));
+                op->children.push_back(std::move(right));
+                nodes.back() = std::move(op);
+                break;
+            }
+        }
+    }
+    return nodes.back();
+}
+
+shared_ptr<TreeNode> parseWith(ParserEngine engine, const vector<Token>& tokens) {
+    if (engine == ParserEngine::LL1) {
+        LL1Parser parser(tokens);
+        return parser.parse();
+    }
+    Parser parser(tokens);
+    return parser.parse();
+}
@@ -0,0 +1,39 @@
+#ifndef LL1PARSER_H
+#define LL1PARSER_H
+
+#include <memory>
+#include <vector>
+#include "Diagnostic.h"
+#include "Token.h"
+#include "TreeNode.h"
+
+using namespace std;
+
+// Table-driven alternative to the recursive descent Parser.
+// FIRST/FOLLOW sets and the parse table are computed at compile time from the
+// grammar declared in LL1Parser.cpp; parsing is a single loop over an explicit
+// symbol stack and builds the same tree shape as Parser::parse.
+class LL1Parser {
+private:
+    std::vector<Token> tokens;
+    std::vector<int> terminals; // grammar terminal of each token, plus end of input
+
+    const Token& tokenAt(size_t index) const;
+    Diagnostic error(int symbol, size_t index) const;
+
+public:
+    explicit LL1Parser(const std::vector<Token>& tokens);
+    // Same errors, with the same codes and messages, as Parser
+    Expected<shared_ptr<TreeNode>> tryParse();
+    // tryParse() that raises its diagnostic as a runtime_error
+    shared_ptr<TreeNode> parse();
+};
+
+enum class ParserEngine {
+    RecursiveDescent,
+    LL1
+};
+
+shared_ptr<TreeNode> parseWith(ParserEngine engine, const vector<Token>& tokens);
+
+#endif // LL1PARSER_H
@@ -0,0 +1,324 @@
+#include "LoopOptimizer.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+
+struct Loop {
+    size_t start;    // first instruction of the body
+    size_t end;      // the back edge
+    int parent = -1; // enclosing loop
+    int depth = 0;   // 0 for outermost loops
+    vector<Instruction> preheader;
+    size_t bodyAt = 0; // new index of the first body instruction
+};
+
+// A product i * k kept up to date in `reduced` while i is stepped
+struct Reduction {
+    int loop;
+    int induction;
+    int factor;
+    int reduced;
+    int step;
+    size_t update; // the instruction stepping the induction variable
+};
+
+bool isJump(const Instruction &instruction) {
+    return instruction.op == OpCode::Jump || instruction.op == OpCode::JumpIfFalse;
+}
+
+bool isArithmetic(OpCode op) {
+    return op == OpCode::Add || op == OpCode::Sub || op == OpCode::Mul || op == OpCode::Div ||
+           op == OpCode::AddChecked || op == OpCode::SubChecked || op == OpCode::MulChecked ||
+           op == OpCode::DivChecked || op == OpCode::DivUnchecked || op == OpCode::Less || op == OpCode::Equal;
+}
+
+// Instructions that may stop the program with an overflow
+bool checksOverflow(OpCode op) {
+    return op == OpCode::AddChecked || op == OpCode::SubChecked || op == OpCode::MulChecked ||
+           op == OpCode::DivChecked;
+}
+
+bool writesRegister(OpCode op) {
+    return op == OpCode::Const || op == OpCode::Move || op == OpCode::Read || isArithmetic(op);
+}
+
+class LoopOptimizer {
+public:
+    explicit LoopOptimizer(Program &program)
+        : program(program), code(program.code), variableCount(static_cast<int>(program.variables.size())) {}
+
+    LoopOptimizationStats run() {
+        findLoops();
+        stats.loops = loops.size();
+        if (loops.empty()) return stats;
+        findDefinitions();
+        findInvariants();
+        findReductions();
+        rebuild();
+        return stats;
+    }
+
+private:
+    Program &program;
+    vector<Instruction> &code;
+    int variableCount;
+    LoopOptimizationStats stats;
+
+    vector<Loop> loops;            // outer loops before the loops they contain
+    vector<int> innermost;         // innermost loop of each instruction, -1 outside loops
+    vector<vector<size_t>> writes; // instructions writing each register, in order
+    vector<int> escapes;           // how many enclosing loops an instruction can leave
+    vector<Reduction> reductions;
+    vector<int> reducedBy;         // reduction replacing each multiplication, -1 if none
+
+    bool inside(size_t index, int loop) const {
+        return index >= loops[loop].start && index <= loops[loop].end;
+    }
+
+    void findLoops() {
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (isJump(code[i]) && static_cast<size_t>(code[i].target) <= i) {
+                Loop loop;
+                loop.start = static_cast<size_t>(code[i].target);
+                loop.end = i;
+                loops.push_back(loop);
+            }
+        }
+        sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) {
+            return a.start != b.start ? a.start < b.start : a.end > b.end;
+        });
+
+        // Structured code nests loops properly, so a stack sweep finds every parent
+        innermost.assign(code.size(), -1);
+        vector<int> open;
+        size_t next = 0;
+        for (size_t i = 0; i < code.size(); ++i) {
+            while (!open.empty() && loops[open.back()].end < i) open.pop_back();
+            while (next < loops.size() && loops[next].start == i) {
+                loops[next].parent = open.empty() ? -1 : open.back();
+                loops[next].depth = static_cast<int>(open.size());
+                open.push_back(static_cast<int>(next++));
+            }
+            innermost[i] = open.empty() ? -1 : open.back();
+        }
+    }
+
+    void findDefinitions() {
+        writes.assign(static_cast<size_t>(program.registerCount), {});
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (writesRegister(code[i].op)) writes[code[i].dst].push_back(i);
+        }
+    }
+
+    // The k-th loop around `index`, counting from the innermost
+    int enclosing(size_t index, int k) const {
+        int loop = innermost[index];
+        while (loop >= 0 && k-- > 0) loop = loops[loop].parent;
+        return loop;
+    }
+
+    int writesInside(int reg, int loop) const {
+        const vector<size_t> &sites = writes[reg];
+        auto first = lower_bound(sites.begin(), sites.end(), loops[loop].start);
+        auto last = upper_bound(sites.begin(), sites.end(), loops[loop].end);
+        return static_cast<int>(last - first);
+    }
+
+    // Whether a register holds the same value throughout the loop once the
+    // preheaders have run
+    bool invariant(int reg, int loop) const {
+        if (reg < variableCount) return writesInside(reg, loop) == 0;
+        for (size_t site: writes[reg]) {
+            if (!inside(site, loop)) continue;
+            int level = loops[innermost[site]].depth - loops[loop].depth;
+            if (escapes[site] <= level) return false;
+        }
+        return true;
+    }
+
+    bool hoistable(size_t index) const {
+        const Instruction &instruction = code[index];
+        if (instruction.dst < variableCount || writes[instruction.dst].size() != 1) return false;
+        if (instruction.op == OpCode::Const) return true;
+        if (!isArithmetic(instruction.op) || checksOverflow(instruction.op)) return false;
+        if (instruction.op != OpCode::Div && instruction.op != OpCode::DivUnchecked) return true;
+        // Only a division that cannot fail may run before its turn; an unchecked one
+        // may have been proven safe only on the path it is on
+        const vector<size_t> &divisor = writes[instruction.b];
+        return instruction.b >= variableCount && divisor.size() == 1 && code[divisor[0]].op == OpCode::Const &&
+               code[divisor[0]].value != 0;
+    }
+
+    void findInvariants() {
+        escapes.assign(code.size(), 0);
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (innermost[i] < 0 || !hoistable(i)) continue;
+            const Instruction &instruction = code[i];
+            int escaped = 0;
+            for (int loop = innermost[i]; loop >= 0; loop = loops[loop].parent) {
+                bool operandsInvariant = instruction.op == OpCode::Const ||
+                                         (invariant(instruction.a, loop) && invariant(instruction.b, loop));
+                if (!operandsInvariant) break;
+                escaped++;
+            }
+            escapes[i] = escaped;
+            if (escaped > 0) {
+                loops[enclosing(i, escaped - 1)].preheader.push_back(instruction);
+                stats.hoisted++;
+            }
+        }
+    }
+
+    // The single instruction stepping `induction` by an invariant amount inside the loop, if any
+    bool inductionUpdate(int induction, int loop, size_t &update) const {
+        if (induction >= variableCount || writesInside(induction, loop) != 1) return false;
+        const vector<size_t> &sites = writes[induction];
+        update = *lower_bound(sites.begin(), sites.end(), loops[loop].start);
+        const Instruction &step = code[update];
+        if (step.op == OpCode::Add || step.op == OpCode::AddChecked) {
+            int amount = step.a == induction ? step.b : step.a;
+            return (step.a == induction || step.b == induction) && amount != induction && invariant(amount, loop);
+        }
+        return (step.op == OpCode::Sub || step.op == OpCode::SubChecked) && step.a == induction &&
+               step.b != induction && invariant(step.b, loop);
+    }
+
+    void findReductions() {
+        reducedBy.assign(code.size(), -1);
+        map<tuple<int, int, int>, int> known; // (loop, induction, factor) -> reduction
+        for (size_t i = 0; i < code.size(); ++i) {
+            const Instruction &instruction = code[i];
+            if (instruction.op != OpCode::Mul || innermost[i] < 0 || escapes[i] > 0) continue;
+            if (instruction.dst >= variableCount && writes[instruction.dst].size() != 1) continue;
+            int loop = innermost[i];
+            for (int side = 0; side < 2; ++side) {
+                int induction = side == 0 ? instruction.a : instruction.b;
+                int factor = side == 0 ? instruction.b : instruction.a;
+                size_t update = 0;
+                if (factor == induction || !invariant(factor, loop) || !inductionUpdate(induction, loop, update)) {
+                    continue;
+                }
+                auto key = make_tuple(loop, induction, factor);
+                auto found = known.find(key);
+                if (found == known.end()) {
+                    found = known.emplace(key, static_cast<int>(reductions.size())).first;
+                    reductions.push_back(reduce(loop, induction, factor, update));
+                }
+                reducedBy[i] = found->second;
+                stats.strengthReduced++;
+                break;
+            }
+        }
+    }
+
+    Reduction reduce(int loop, int induction, int factor, size_t update) {
+        const Instruction &step = code[update];
+        int amount = step.a == induction ? step.b : step.a;
+        Reduction reduction{loop, induction, factor, program.registerCount, program.registerCount + 1, update};
+        program.registerCount += 2;
+
+        Instruction start = step;
+        start.op = OpCode::Mul;
+        start.dst = reduction.reduced;
+        start.a = induction;
+        start.b = factor;
+        Instruction stride = start;
+        stride.dst = reduction.step;
+        stride.a = amount;
+        loops[loop].preheader.push_back(start);
+        loops[loop].preheader.push_back(stride);
+        return reduction;
+    }
+
+    void rebuild() {
+        // Loops starting at the same instruction, outermost first
+        vector<vector<int>> startingAt(code.size());
+        for (size_t l = 0; l < loops.size(); ++l) startingAt[loops[l].start].push_back(static_cast<int>(l));
+        vector<vector<int>> updatesAt(code.size());
+        for (size_t r = 0; r < reductions.size(); ++r) updatesAt[reductions[r].update].push_back(static_cast<int>(r));
+
+        // Uses of a removed product read the running sum instead
+        vector<int> renamed(static_cast<size_t>(program.registerCount), -1);
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (reducedBy[i] >= 0 && code[i].dst >= variableCount) renamed[code[i].dst] = reductions[reducedBy[i]].reduced;
+        }
+        auto rename = [&](int reg) { return renamed[reg] >= 0 ? renamed[reg] : reg; };
+
+        vector<Instruction> result;
+        result.reserve(code.size() + stats.strengthReduced * 3);
+        vector<size_t> slot(code.size());         // new index where each old instruction's place begins
+        vector<size_t> position(code.size() + 1); // new index of the first kept instruction from here on
+        for (size_t i = 0; i < code.size(); ++i) {
+            slot[i] = result.size();
+            for (int l: startingAt[i]) {
+                for (Instruction instruction: loops[l].preheader) {
+                    instruction.a = rename(instruction.a);
+                    instruction.b = rename(instruction.b);
+                    result.push_back(instruction);
+                }
+                loops[l].bodyAt = result.size();
+            }
+            position[i] = result.size();
+            if (escapes[i] > 0) continue;
+
+            Instruction instruction = code[i];
+            if (reducedBy[i] >= 0) {
+                if (instruction.dst >= variableCount) continue;
+                instruction.op = OpCode::Move;
+                instruction.a = reductions[reducedBy[i]].reduced;
+            } else {
+                instruction.a = rename(instruction.a);
+                instruction.b = rename(instruction.b);
+            }
+            result.push_back(instruction);
+
+            for (int r: updatesAt[i]) {
+                // The running sum wraps even where the induction variable is checked
+                Instruction step = instruction;
+                bool subtract = instruction.op == OpCode::Sub || instruction.op == OpCode::SubChecked;
+                step.op = subtract ? OpCode::Sub : OpCode::Add;
+                step.dst = step.a = reductions[r].reduced;
+                step.b = reductions[r].step;
+                result.push_back(step);
+            }
+        }
+        position[code.size()] = result.size();
+        // Hoisted instructions leave no trace, so their position is the next kept one
+        for (size_t i = code.size(); i-- > 0;) {
+            if (escapes[i] > 0 || (reducedBy[i] >= 0 && code[i].dst >= variableCount)) position[i] = position[i + 1];
+        }
+
+        // Every jump lands before Halt, so its target is an old instruction
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (!isJump(code[i])) continue;
+            size_t target = static_cast<size_t>(code[i].target);
+            size_t mapped = slot[target];
+            // A back edge skips the preheaders of its own loop and the loops around it
+            for (int l: startingAt[target]) {
+                if (inside(i, l)) mapped = loops[l].bodyAt;
+            }
+            result[position[i]].target = static_cast<int>(mapped);
+        }
+
+        for (StatementInfo &statement: program.statements) {
+            if (statement.kind == NodeKind::Repeat) {
+                statement.test = position[statement.test];
+                statement.entry = static_cast<size_t>(result[statement.test].target);
+            } else {
+                statement.entry = position[statement.entry];
+            }
+        }
+        code = move(result);
+    }
+};
+
+} // namespace
+
+LoopOptimizationStats optimizeLoops(Program &program) {
+    LoopOptimizer optimizer(program);
+    return optimizer.run();
+}
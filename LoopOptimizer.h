@@ -0,0 +1,30 @@
+#ifndef LOOPOPTIMIZER_H
+#define LOOPOPTIMIZER_H
+
+#include <cstddef>
+#include "CodeGenerator.h"
+
+using namespace std;
+
+struct LoopOptimizationStats {
+    size_t loops = 0;
+    size_t hoisted = 0;         // instructions moved out of a loop
+    size_t strengthReduced = 0; // multiplications turned into running sums
+};
+
+// Optimizes the repeat loops of a freshly compiled program. Loops are found from
+// their back edges (jumps to an earlier instruction).
+//  - Loop-invariant code motion: temporaries computed only from constants and
+//    variables the loop never assigns move to a preheader in front of the loop.
+//    A division moves only when its divisor is a nonzero constant and checked
+//    arithmetic never moves, so no error is raised that the original program
+//    would not raise.
+//  - Strength reduction: for an induction variable i whose only assignment in
+//    the loop is i := i +/- c, a product i * k with c and k invariant becomes a
+//    register that starts at i * k and is stepped by c * k next to i. Checked
+//    products stay as they are.
+// Results, runtime errors and how often each statement runs stay the same; the
+// registers added for reduced products are written more than once.
+LoopOptimizationStats optimizeLoops(Program &program);
+
+#endif // LOOPOPTIMIZER_H
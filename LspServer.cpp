@@ -0,0 +1,289 @@
+#include "LspServer.h"
+#include "Scanner.h"
+#include "Parser.h"
+#include "SemanticAnalyzer.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+JsonValue position(int line, int character) {
+    JsonValue value = JsonValue::object();
+    value.set("line", line);
+    value.set("character", character);
+    return value;
+}
+
+JsonValue range(int line, int character, int endLine, int endCharacter) {
+    JsonValue value = JsonValue::object();
+    value.set("start", position(line, character));
+    value.set("end", position(endLine, endCharacter));
+    return value;
+}
+
+// Scanner and Parser messages start with "Error at line N"; the whole line is marked
+JsonValue diagnostic(const string &message, int line = 0, bool error = true) {
+    if (line <= 0) sscanf(message.c_str(), "Error at line %d", &line);
+    line = max(line, 1);
+
+    JsonValue value = JsonValue::object();
+    value.set("range", range(line - 1, 0, line, 0));
+    value.set("severity", error ? 1 : 2);
+    value.set("source", "tiny");
+    value.set("message", message);
+    return value;
+}
+
+// Largest message body read into memory; a longer one is skipped
+constexpr size_t MAX_MESSAGE_LENGTH = size_t(64) << 20;
+
+// Value of a Content-Length header: a decimal number, optionally between blanks
+bool parseLength(const string &text, size_t &length) {
+    size_t first = text.find_first_not_of(" \t");
+    if (first == string::npos) return false;
+    const char *last = text.data() + text.find_last_not_of(" \t") + 1;
+    from_chars_result result = from_chars(text.data() + first, last, length);
+    return result.ec == errc() && result.ptr == last;
+}
+
+} // namespace
+
+int LspServer::run(istream &in, ostream &out) {
+    this->out = &out;
+    bool exit = false;
+    string header;
+    while (!exit) {
+        // Headers end with an empty line; only Content-Length matters
+        size_t length = 0;
+        string lengthText;
+        bool haveLength = false;
+        while (getline(in, header)) {
+            if (!header.empty() && header.back() == '\r') header.pop_back();
+            if (header.empty()) break;
+            if (header.rfind("Content-Length:", 0) == 0) {
+                lengthText = header.substr(15);
+                haveLength = true;
+            }
+        }
+        if (!in || !haveLength) break;
+
+        // Without a valid length the next message cannot be found, so serving stops
+        if (!parseLength(lengthText, length)) {
+            parseError("Invalid Content-Length:" + lengthText);
+            break;
+        }
+        if (length > MAX_MESSAGE_LENGTH) {
+            in.ignore(static_cast<streamsize>(min<size_t>(length, numeric_limits<streamsize>::max())));
+            if (in.eof()) break;
+            parseError("Message of " + to_string(length) + " bytes is too long");
+            continue;
+        }
+
+        string body(length, '\0');
+        in.read(&body[0], static_cast<streamsize>(length));
+        if (!in) break;
+
+        try {
+            handle(JsonValue::parse(body), exit);
+        } catch (const runtime_error &e) {
+            parseError(e.what());
+        }
+    }
+    return shutdownRequested ? 0 : 1;
+}
+
+void LspServer::parseError(const string &message) {
+    JsonValue error = JsonValue::object();
+    error.set("code", -32700);
+    error.set("message", message);
+    JsonValue response = JsonValue::object();
+    response.set("jsonrpc", "2.0");
+    response.set("id", JsonValue());
+    response.set("error", error);
+    send(response);
+}
+
+void LspServer::send(const JsonValue &message) {
+    string body = message.dump();
+    *out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    out->flush();
+}
+
+void LspServer::reply(const JsonValue &id, JsonValue result) {
+    JsonValue response = JsonValue::object();
+    response.set("jsonrpc", "2.0");
+    response.set("id", id);
+    response.set("result", move(result));
+    send(response);
+}
+
+void LspServer::handle(const JsonValue &message, bool &exit) {
+    const string &method = message["method"].text;
+    const JsonValue &id = message["id"];
+    const JsonValue &params = message["params"];
+
+    if (method == "initialize") {
+        JsonValue capabilities = JsonValue::object();
+        capabilities.set("textDocumentSync", 1); // full document on every change
+        capabilities.set("hoverProvider", true);
+        capabilities.set("definitionProvider", true);
+        JsonValue result = JsonValue::object();
+        result.set("capabilities", capabilities);
+        reply(id, result);
+    } else if (method == "shutdown") {
+        shutdownRequested = true;
+        reply(id, JsonValue());
+    } else if (method == "exit") {
+        exit = true;
+    } else if (method == "textDocument/didOpen") {
+        const string &uri = params["textDocument"]["uri"].text;
+        Document &document = documents[uri];
+        document.text = params["textDocument"]["text"].text;
+        analyse(uri, document);
+    } else if (method == "textDocument/didChange") {
+        const string &uri = params["textDocument"]["uri"].text;
+        const JsonValue &changes = params["contentChanges"];
+        if (changes.items.empty()) return;
+        Document &document = documents[uri];
+        document.text = changes.items.back()["text"].text;
+        analyse(uri, document);
+    } else if (method == "textDocument/didClose") {
+        const string &uri = params["textDocument"]["uri"].text;
+        documents.erase(uri);
+        JsonValue cleared = JsonValue::object();
+        cleared.set("uri", uri);
+        cleared.set("diagnostics", JsonValue::array());
+        JsonValue notification = JsonValue::object();
+        notification.set("jsonrpc", "2.0");
+        notification.set("method", "textDocument/publishDiagnostics");
+        notification.set("params", cleared);
+        send(notification);
+    } else if (method == "textDocument/hover") {
+        reply(id, hover(params));
+    } else if (method == "textDocument/definition") {
+        reply(id, definition(params));
+    } else if (!id.isNull()) {
+        JsonValue error = JsonValue::object();
+        error.set("code", -32601);
+        error.set("message", "Method not found: " + method);
+        JsonValue response = JsonValue::object();
+        response.set("jsonrpc", "2.0");
+        response.set("id", id);
+        response.set("error", error);
+        send(response);
+    }
+}
+
+void LspServer::analyse(const string &uri, Document &document) {
+    document.tokens.clear();
+    document.syntaxTree.reset();
+    document.symbols.clear();
+    JsonValue diagnostics = JsonValue::array();
+
+    try {
+        istringstream in(document.text);
+        bool commentState = false;
+        int lineCount = 1;
+        string line;
+        while (getline(in, line)) {
+            vector<Token> tokens = tokenize(line, lineCount, commentState);
+            document.tokens.insert(document.tokens.end(), tokens.begin(), tokens.end());
+            lineCount++;
+        }
+        if (!document.tokens.empty()) {
+            Parser parser(document.tokens);
+            document.syntaxTree = parser.parse();
+            for (const SemanticIssue &issue: checkSemantics(*document.syntaxTree)) {
+                diagnostics.push(diagnostic(issue.message, issue.line, issue.error));
+            }
+        }
+    } catch (const runtime_error &e) {
+        diagnostics.push(diagnostic(e.what()));
+    }
+
+    // A variable is defined by its first assignment or read
+    const vector<Token> &tokens = document.tokens;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].type != "IDENTIFIER") continue;
+        Symbol &symbol = document.symbols[tokens[i].value];
+        symbol.references++;
+        bool defines = (i + 1 < tokens.size() && tokens[i + 1].type == "ASSIGN") ||
+                       (i > 0 && tokens[i - 1].type == "READ");
+        if (defines && symbol.line < 0) {
+            symbol.line = tokens[i].line;
+            symbol.column = tokens[i].column;
+        }
+    }
+
+    JsonValue published = JsonValue::object();
+    published.set("uri", uri);
+    published.set("diagnostics", diagnostics);
+    JsonValue notification = JsonValue::object();
+    notification.set("jsonrpc", "2.0");
+    notification.set("method", "textDocument/publishDiagnostics");
+    notification.set("params", published);
+    send(notification);
+}
+
+// Tokens are ordered by line and column, so the candidates on a line are found by binary search
+const Token *LspServer::tokenAt(const Document &document, const JsonValue &position) const {
+    int line = static_cast<int>(position["line"].number) + 1;
+    int character = static_cast<int>(position["character"].number);
+    const vector<Token> &tokens = document.tokens;
+    auto it = lower_bound(tokens.begin(), tokens.end(), line,
+                          [](const Token &token, int value) { return token.line < value; });
+    for (; it != tokens.end() && it->line == line; ++it) {
+        if (character >= it->column && character <= it->column + static_cast<int>(it->value.size())) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+JsonValue LspServer::hover(const JsonValue &params) const {
+    auto document = documents.find(params["textDocument"]["uri"].text);
+    if (document == documents.end()) return JsonValue();
+    const Token *token = tokenAt(document->second, params["position"]);
+    if (!token) return JsonValue();
+
+    string text;
+    if (token->type == "IDENTIFIER") {
+        const Symbol &symbol = document->second.symbols.at(token->value);
+        text = "**" + token->value + "** : variable, ";
+        text += symbol.line > 0 ? "first defined at line " + to_string(symbol.line) : "never assigned";
+        text += ", " + to_string(symbol.references) + " reference" + (symbol.references == 1 ? "" : "s");
+    } else {
+        text = "`" + token->value + "` : " + token->type;
+    }
+
+    JsonValue contents = JsonValue::object();
+    contents.set("kind", "markdown");
+    contents.set("value", text);
+    JsonValue result = JsonValue::object();
+    result.set("contents", contents);
+    int length = static_cast<int>(token->value.size());
+    result.set("range", range(token->line - 1, token->column, token->line - 1, token->column + length));
+    return result;
+}
+
+JsonValue LspServer::definition(const JsonValue &params) const {
+    const string &uri = params["textDocument"]["uri"].text;
+    auto document = documents.find(uri);
+    if (document == documents.end()) return JsonValue();
+    const Token *token = tokenAt(document->second, params["position"]);
+    if (!token || token->type != "IDENTIFIER") return JsonValue();
+
+    const Symbol &symbol = document->second.symbols.at(token->value);
+    if (symbol.line < 0) return JsonValue();
+    int length = static_cast<int>(token->value.size());
+    JsonValue location = JsonValue::object();
+    location.set("uri", uri);
+    location.set("range", range(symbol.line - 1, symbol.column, symbol.line - 1, symbol.column + length));
+    return location;
+}
@@ -0,0 +1,54 @@
+#ifndef LSPSERVER_H
+#define LSPSERVER_H
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Json.h"
+#include "Token.h"
+#include "TreeNode.h"
+
+using namespace std;
+
+// Language server speaking LSP over a pair of streams (normally stdin/stdout).
+// Open documents stay in memory with their tokens, syntax tree and symbols;
+// every change is rescanned and reparsed and diagnostics are published.
+// Supports hover and go-to-definition on variables.
+class LspServer {
+public:
+    // Serves until the client sends "exit"; returns the process exit code
+    int run(istream &in, ostream &out);
+
+private:
+    struct Symbol {
+        int line = -1;   // first assignment or read, -1 if never defined
+        int column = 0;
+        int references = 0;
+    };
+
+    struct Document {
+        string text;
+        vector<Token> tokens;
+        shared_ptr<TreeNode> syntaxTree;
+        unordered_map<string, Symbol> symbols;
+    };
+
+    unordered_map<string, Document> documents;
+    ostream *out = nullptr;
+    bool shutdownRequested = false;
+
+    void handle(const JsonValue &message, bool &exit);
+    void send(const JsonValue &message);
+    void reply(const JsonValue &id, JsonValue result);
+    // Answers a message that could not be read with a JSON-RPC parse error
+    void parseError(const string &message);
+    void analyse(const string &uri, Document &document);
+    const Token *tokenAt(const Document &document, const JsonValue &position) const;
+    JsonValue hover(const JsonValue &params) const;
+    JsonValue definition(const JsonValue &params) const;
+};
+
+#endif // LSPSERVER_H
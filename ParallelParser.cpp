@@ -0,0 +1,96 @@
+#include "ParallelParser.h"
+#include "Parser.h"
+#include <exception>
+#include <iterator>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Below this many tokens per thread, splitting costs more than it saves
+const size_t minTokensPerChunk = 4096;
+
+struct ChunkResult {
+    shared_ptr<TreeNode> sequence;
+    bool complete = true; // false when the serial parse would stop inside this chunk
+    exception_ptr error;
+};
+
+// Indices of the SEMICOLON tokens that separate top-level statements
+vector<size_t> topLevelSplits(const vector<Token> &tokens) {
+    vector<size_t> splits;
+    int depth = 0;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const string &type = tokens[i].type;
+        if (type == "IF" || type == "REPEAT") {
+            depth++;
+        } else if (type == "END" || type == "UNTIL") {
+            // Unbalanced input: leave the rest to a single chunk
+            if (--depth < 0) break;
+        } else if (type == "SEMICOLON" && depth == 0) {
+            splits.push_back(i);
+        }
+    }
+    return splits;
+}
+
+} // namespace
+
+shared_ptr<TreeNode> parseParallel(const vector<Token>& tokens, unsigned threadCount) {
+    if (threadCount == 0) threadCount = max(1u, thread::hardware_concurrency());
+    size_t chunkCount = min<size_t>(threadCount, tokens.size() / minTokensPerChunk);
+    if (chunkCount <= 1) {
+        Parser parser(tokens);
+        return parser.parse();
+    }
+
+    // Pick split points that balance the number of tokens per chunk
+    vector<size_t> splits = topLevelSplits(tokens);
+    vector<size_t> boundaries;
+    size_t target = tokens.size() / chunkCount;
+    for (size_t split: splits) {
+        if (split >= target * (boundaries.size() + 1)) {
+            boundaries.push_back(split);
+            if (boundaries.size() == chunkCount - 1) break;
+        }
+    }
+    chunkCount = boundaries.size() + 1;
+
+    // Each chunk starts with the SEMICOLON before it, so errors see the same previous
+    // token as in the serial parse, and all but the last end with their SEMICOLON.
+    vector<ChunkResult> results(chunkCount);
+    vector<thread> workers;
+    for (size_t k = 0; k < chunkCount; ++k) {
+        workers.emplace_back([&, k] {
+            bool last = k + 1 == chunkCount;
+            size_t begin = k == 0 ? 0 : boundaries[k - 1];
+            size_t end = last ? tokens.size() : boundaries[k] + 1;
+            try {
+                Parser parser(vector<Token>(tokens.begin() + begin, tokens.begin() + end));
+                results[k].sequence = parser.parseChunk(k == 0 ? 0 : 1, !last);
+                results[k].complete = last || parser.atLastToken();
+            } catch (...) {
+                results[k].error = current_exception();
+            }
+        });
+    }
+    for (thread &worker: workers) {
+        worker.join();
+    }
+
+    // Append the statements of every chunk to the first chunk's sequence
+    shared_ptr<TreeNode> root;
+    for (ChunkResult &result: results) {
+        if (result.error) rethrow_exception(result.error);
+        if (!root) {
+            root = result.sequence;
+        } else {
+            auto &statements = result.sequence->children;
+            root->children.insert(root->children.end(), make_move_iterator(statements.begin()),
+                                  make_move_iterator(statements.end()));
+        }
+        if (!result.complete) break;
+    }
+    return root;
+}
@@ -0,0 +1,17 @@
+#ifndef PARALLELPARSER_H
+#define PARALLELPARSER_H
+
+#include <memory>
+#include <vector>
+#include "Token.h"
+#include "TreeNode.h"
+
+using namespace std;
+
+// Parses like Parser::parse, but splits the top-level statement sequence at
+// SEMICOLONs outside if/repeat blocks and parses the pieces on worker threads.
+// The result, including which error is reported, matches the serial parse.
+// threadCount 0 uses one thread per hardware core.
+shared_ptr<TreeNode> parseParallel(const vector<Token>& tokens, unsigned threadCount = 0);
+
+#endif // PARALLELPARSER_H
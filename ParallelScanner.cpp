@@ -0,0 +1,164 @@
+#include "ParallelScanner.h"
+#include "Scanner.h"
+#include <iterator>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Below this many bytes per thread, splitting costs more than it saves
+const size_t minBytesPerChunk = 1 << 20;
+
+// Tokens of a run of lines, numbered from 1 within the chunk
+struct LexRun {
+    vector<Token> tokens;
+    int errorLine = 0; // local line that failed to scan, 0 if none
+};
+
+struct Chunk {
+    size_t begin = 0;
+    size_t end = 0;
+    int lineCount = 0;
+    bool hasBrace = false;
+    bool exitState = false;  // comment state after the last brace
+    int speculativeLines = 0; // lines up to and including the first one with a brace
+    LexRun outside;           // speculative lines, entered outside a comment
+    LexRun inside;            // speculative lines, entered inside a comment
+    LexRun rest;              // remaining lines, whose entry state is already known
+};
+
+// Lexes lines [first, last) of the chunk; stops at the first error like the serial loop
+void lexLines(const string &source, const vector<size_t> &lineStarts, int first, int last,
+              bool state, ScannerEngine engine, LexRun &run) {
+    string line;
+    for (int i = first; i < last; ++i) {
+        size_t start = lineStarts[i];
+        size_t length = lineStarts[i + 1] - start - 1;
+        line.assign(source, start, length);
+        // Speculative runs fail often, so no exceptions here
+        Expected<vector<Token>> tokens = tryTokenizeWith(engine, line, i + 1, state);
+        if (!tokens) {
+            run.errorLine = i + 1;
+            return;
+        }
+        run.tokens.insert(run.tokens.end(), make_move_iterator(tokens.value().begin()),
+                          make_move_iterator(tokens.value().end()));
+    }
+}
+
+void lexChunk(const string &source, ScannerEngine engine, Chunk &chunk) {
+    // Start offset of each line, plus one past the end of the last line
+    vector<size_t> lineStarts;
+    size_t firstBrace = string::npos;
+    size_t lastBrace = string::npos;
+    for (size_t i = chunk.begin; i < chunk.end; ++i) {
+        if (i == chunk.begin || source[i - 1] == '\n') lineStarts.push_back(i);
+        char c = source[i];
+        if (c == '{' || c == '}') {
+            if (firstBrace == string::npos) firstBrace = i;
+            lastBrace = i;
+        }
+    }
+    chunk.lineCount = static_cast<int>(lineStarts.size());
+    lineStarts.push_back(chunk.end > chunk.begin && source[chunk.end - 1] == '\n' ? chunk.end : chunk.end + 1);
+
+    chunk.hasBrace = firstBrace != string::npos;
+    chunk.speculativeLines = chunk.lineCount;
+    if (chunk.hasBrace) {
+        chunk.exitState = source[lastBrace] == '{';
+        while (chunk.speculativeLines > 1 && lineStarts[chunk.speculativeLines - 1] > firstBrace) {
+            chunk.speculativeLines--;
+        }
+    }
+
+    // Both speculative runs agree after the line holding the first brace
+    lexLines(source, lineStarts, 0, chunk.speculativeLines, false, engine, chunk.outside);
+    lexLines(source, lineStarts, 0, chunk.speculativeLines, true, engine, chunk.inside);
+    if (chunk.speculativeLines < chunk.lineCount) {
+        size_t lineStart = lineStarts[chunk.speculativeLines - 1];
+        size_t lineEnd = lineStarts[chunk.speculativeLines];
+        bool state = false;
+        for (size_t i = lineStart; i < lineEnd; ++i) {
+            if (source[i] == '{') state = true;
+            if (source[i] == '}') state = false;
+        }
+        lexLines(source, lineStarts, chunk.speculativeLines, chunk.lineCount, state, engine, chunk.rest);
+    }
+}
+
+template<typename Function>
+void runOnThreads(size_t count, Function function) {
+    vector<thread> workers;
+    for (size_t k = 0; k < count; ++k) {
+        workers.emplace_back(function, k);
+    }
+    for (thread &worker: workers) {
+        worker.join();
+    }
+}
+
+} // namespace
+
+vector<Token> tokenizeParallel(const string& source, unsigned threadCount, ScannerEngine engine) {
+    if (threadCount == 0) threadCount = max(1u, thread::hardware_concurrency());
+    size_t chunkCount = max<size_t>(1, min<size_t>(threadCount, source.size() / minBytesPerChunk));
+
+    // Chunks of whole lines of roughly equal size
+    vector<Chunk> chunks;
+    size_t begin = 0;
+    for (size_t k = 1; k <= chunkCount && begin < source.size(); ++k) {
+        size_t end = source.find('\n', max(begin, source.size() / chunkCount * k));
+        end = end == string::npos || k == chunkCount ? source.size() : end + 1;
+        chunks.push_back(Chunk());
+        chunks.back().begin = begin;
+        chunks.back().end = end;
+        begin = end;
+    }
+
+    runOnThreads(chunks.size(), [&](size_t k) { lexChunk(source, engine, chunks[k]); });
+
+    // Prefix pass: real entry state, first line and output offset of each chunk
+    vector<LexRun *> prefixes(chunks.size());
+    vector<int> firstLines(chunks.size());
+    vector<size_t> offsets(chunks.size() + 1);
+    bool state = inComment;
+    int line = 1;
+    for (size_t k = 0; k < chunks.size(); ++k) {
+        Chunk &chunk = chunks[k];
+        LexRun *prefix = state ? &chunk.inside : &chunk.outside;
+        int errorLine = prefix->errorLine ? prefix->errorLine : chunk.rest.errorLine;
+        if (errorLine) {
+            // Rescan the failing line with its real line number and state to raise the serial error
+            size_t start = chunk.begin;
+            for (int i = 1; i < errorLine; ++i) start = source.find('\n', start) + 1;
+            size_t end = source.find('\n', start);
+            bool lineState = state;
+            for (size_t i = chunk.begin; i < start; ++i) {
+                if (source[i] == '{') lineState = true;
+                if (source[i] == '}') lineState = false;
+            }
+            tryTokenizeWith(engine, source.substr(start, end == string::npos ? string::npos : end - start),
+                            line + errorLine - 1, lineState).valueOrRaise();
+        }
+        prefixes[k] = prefix;
+        firstLines[k] = line;
+        offsets[k + 1] = offsets[k] + prefix->tokens.size() + chunk.rest.tokens.size();
+        if (chunk.hasBrace) state = chunk.exitState;
+        line += chunk.lineCount;
+    }
+    inComment = state;
+
+    // Merge with corrected line numbers
+    vector<Token> tokens(offsets.back());
+    runOnThreads(chunks.size(), [&](size_t k) {
+        size_t out = offsets[k];
+        for (LexRun *run: {prefixes[k], &chunks[k].rest}) {
+            for (Token &token: run->tokens) {
+                tokens[out] = std::move(token);
+                tokens[out++].line += firstLines[k] - 1;
+            }
+        }
+    });
+    return tokens;
+}
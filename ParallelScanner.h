@@ -0,0 +1,20 @@
+#ifndef PARALLELSCANNER_H
+#define PARALLELSCANNER_H
+
+#include <string>
+#include <vector>
+#include "DfaScanner.h"
+#include "Token.h"
+
+using namespace std;
+
+// Tokenizes a whole source buffer with the same result as calling tokenize() on
+// each line in turn. The buffer is split into chunks of whole lines that are lexed
+// on worker threads, speculatively both inside and outside a comment; a prefix pass
+// then picks the real comment state of each chunk and fixes up line numbers.
+// Starts from and updates the global inComment. threadCount 0 uses one thread per core;
+// `engine` picks the scanner that lexes each line.
+vector<Token> tokenizeParallel(const string& source, unsigned threadCount = 0,
+                               ScannerEngine engine = ScannerEngine::TokenMap);
+
+#endif // PARALLELSCANNER_H
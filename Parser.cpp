@@ -1,28 +1,52 @@
 #include "Parser.h"
-#include <stdexcept>
 
 using namespace std;
 
 Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens), currentTokenIndex(0) {}
 
+Parser::Parser(std::vector<Token>&& tokens) : tokens(std::move(tokens)), currentTokenIndex(0) {}
+
+Parser::Parser(std::function<bool(std::vector<Token>&)> source) : currentTokenIndex(0), source(std::move(source)) {}
+
+// Makes sure tokens[index] exists, pulling from the source if there is one
+bool Parser::fetch(size_t index) {
+    while (index >= tokens.size()) {
+        if (!source || !source(tokens)) return false;
+    }
+    return true;
+}
+
+shared_ptr<TreeNode> Parser::intern(shared_ptr<TreeNode> node) {
+    return interner ? interner->intern(std::move(node)) : node;
+}
+
 Token Parser::currentToken() {
     return tokens[currentTokenIndex];
 }
 
 void Parser::advance() {
-    if (currentTokenIndex < tokens.size() - 1) {
+    if (fetch(currentTokenIndex + 1)) {
         currentTokenIndex++;
     }
 }
 
-void Parser::match(const std::string& expectedType) {
+// Records the first error; the grammar functions then return null all the way up
+shared_ptr<TreeNode> Parser::fail(Diagnostic diagnostic) {
+    if (!failed) {
+        failed = true;
+        error = std::move(diagnostic);
+    }
+    return nullptr;
+}
+
+bool Parser::match(const std::string& expectedType) {
     if (currentToken().type == expectedType) {
         advance();
-    } else {
-        throw runtime_error(
-            "Error at line " + to_string(tokens[currentTokenIndex - 1].line) + " : Unexpected token \"" +
-            currentToken().type + "\", expected \"" + expectedType + "\"");
+        return true;
     }
+    int line = tokens[currentTokenIndex > 0 ? currentTokenIndex - 1 : 0].line;
+    fail(Diagnostic{DiagnosticCode::UnexpectedToken, line, 0, currentToken().type, expectedType});
+    return false;
 }
 
 shared_ptr<TreeNode> Parser::program() {
@@ -30,135 +54,225 @@ shared_ptr<TreeNode> Parser::program() {
 }
 
 shared_ptr<TreeNode> Parser::stmt_sequence() {
-    auto node = statement();
+    auto node = std::make_shared<TreeNode>(NodeKind::Seq);
+    node->line = currentToken().line;
+    auto first = statement();
+    if (!first) return nullptr;
+    node->children.push_back(first);
 
     while (currentToken().type == "SEMICOLON") {
         match("SEMICOLON");
-        node->siblings.push_back(statement());
+        auto next = statement();
+        if (!next) return nullptr;
+        node->children.push_back(next);
     }
     return node;
 }
 
 shared_ptr<TreeNode> Parser::statement() {
+    if (monitor) {
+        monitor->position.store(currentTokenIndex, memory_order_relaxed);
+        if (monitor->cancelled.load(memory_order_relaxed)) return fail(Diagnostic{DiagnosticCode::Cancelled, 0, 0, "", ""});
+    }
+
     if (currentToken().type == "IF") return if_stmt();
     if (currentToken().type == "REPEAT") return repeat_stmt();
     if (currentToken().type == "IDENTIFIER") return assign_stmt();
     if (currentToken().type == "READ") return read_stmt();
     if (currentToken().type == "WRITE") return write_stmt();
 
-    throw runtime_error(
-        "Error at line " + to_string(currentToken().line) + " : Invalid statement \"" + currentToken().value + "\"");
+    const Token &token = tokens[currentTokenIndex];
+    return fail(Diagnostic{DiagnosticCode::InvalidStatement, token.line, token.column, token.value, ""});
 }
 
 shared_ptr<TreeNode> Parser::if_stmt() {
-    auto node = std::make_shared<TreeNode>("if");
+    auto node = std::make_shared<TreeNode>(NodeKind::If);
+    node->line = currentToken().line;
     match("IF");
-    node->children.push_back(exp());
-    match("THEN");
-    node->children.push_back(stmt_sequence());
+    auto test = exp();
+    if (!test || !match("THEN")) return nullptr;
+    node->children.push_back(test);
+    auto thenPart = stmt_sequence();
+    if (!thenPart) return nullptr;
+    node->children.push_back(thenPart);
 
     if (currentToken().type == "ELSE") {
         match("ELSE");
-        node->children.push_back(stmt_sequence());
+        auto elsePart = stmt_sequence();
+        if (!elsePart) return nullptr;
+        node->children.push_back(elsePart);
     }
 
-    match("END");
+    if (!match("END")) return nullptr;
     return node;
 }
 
 shared_ptr<TreeNode> Parser::repeat_stmt() {
-    auto node = std::make_shared<TreeNode>("repeat");
+    auto node = std::make_shared<TreeNode>(NodeKind::Repeat);
+    node->line = currentToken().line;
     match("REPEAT");
-    node->children.push_back(stmt_sequence());
-    match("UNTIL");
-    node->children.push_back(exp());
+    auto body = stmt_sequence();
+    node->untilLine = currentToken().line;
+    if (!body || !match("UNTIL")) return nullptr;
+    node->children.push_back(body);
+    auto test = exp();
+    if (!test) return nullptr;
+    node->children.push_back(test);
     return node;
 }
 
 shared_ptr<TreeNode> Parser::assign_stmt() {
-    auto node = std::make_shared<TreeNode>("assign", currentToken().value);
+    auto node = std::make_shared<TreeNode>(NodeKind::Assign, currentToken().value);
+    node->line = currentToken().line;
     match("IDENTIFIER");
-    match("ASSIGN");
-    node->children.push_back(exp());
+    if (!match("ASSIGN")) return nullptr;
+    auto value = exp();
+    if (!value) return nullptr;
+    node->children.push_back(value);
     return node;
 }
 
 shared_ptr<TreeNode> Parser::read_stmt() {
+    int line = currentToken().line;
     match("READ");
-    auto node = std::make_shared<TreeNode>("read", currentToken().value);
-    match("IDENTIFIER");
+    auto node = std::make_shared<TreeNode>(NodeKind::Read, currentToken().value);
+    node->line = line;
+    if (!match("IDENTIFIER")) return nullptr;
     return node;
 }
 
 shared_ptr<TreeNode> Parser::write_stmt() {
-    auto node = std::make_shared<TreeNode>("write");
+    auto node = std::make_shared<TreeNode>(NodeKind::Write);
+    node->line = currentToken().line;
     match("WRITE");
-    node->children.push_back(exp());
+    auto value = exp();
+    if (!value) return nullptr;
+    node->children.push_back(value);
     return node;
 }
 
 shared_ptr<TreeNode> Parser::exp() {
     auto node = simple_exp();
+    if (!node) return nullptr;
 
     if (currentToken().type == "LESSTHAN" || currentToken().type == "EQUAL") {
-        auto opNode = std::make_shared<TreeNode>("op", currentToken().value);
+        auto opNode = std::make_shared<TreeNode>(opFromToken(currentToken().type));
+        opNode->line = currentToken().line;
         match(currentToken().type);
+        auto right = simple_exp();
+        if (!right) return nullptr;
         opNode->children.push_back(node);
-        opNode->children.push_back(simple_exp());
-        node = opNode;
+        opNode->children.push_back(right);
+        node = intern(opNode);
     }
     return node;
 }
 
 shared_ptr<TreeNode> Parser::simple_exp() {
     auto node = term();
+    if (!node) return nullptr;
 
     while (currentToken().type == "PLUS" || currentToken().type == "MINUS") {
-        auto opNode = std::make_shared<TreeNode>("op", currentToken().value);
+        auto opNode = std::make_shared<TreeNode>(opFromToken(currentToken().type));
+        opNode->line = currentToken().line;
         match(currentToken().type);
+        auto right = term();
+        if (!right) return nullptr;
         opNode->children.push_back(node);
-        opNode->children.push_back(term());
-        node = opNode;
+        opNode->children.push_back(right);
+        node = intern(opNode);
     }
     return node;
 }
 
 shared_ptr<TreeNode> Parser::term() {
     auto node = factor();
+    if (!node) return nullptr;
 
     while (currentToken().type == "MULT" || currentToken().type == "DIV") {
-        auto opNode = std::make_shared<TreeNode>("op", currentToken().value);
+        auto opNode = std::make_shared<TreeNode>(opFromToken(currentToken().type));
+        opNode->line = currentToken().line;
         match(currentToken().type);
+        auto right = factor();
+        if (!right) return nullptr;
         opNode->children.push_back(node);
-        opNode->children.push_back(factor());
-        node = opNode;
+        opNode->children.push_back(right);
+        node = intern(opNode);
     }
     return node;
 }
 
 shared_ptr<TreeNode> Parser::factor() {
     if (currentToken().type == "NUMBER") {
-        auto node = std::make_shared<TreeNode>("Const", currentToken().value);
+        auto node = std::make_shared<TreeNode>(NodeKind::Const, currentToken().value);
+        node->line = currentToken().line;
         match("NUMBER");
-        return node;
+        return intern(node);
     }
     if (currentToken().type == "IDENTIFIER") {
-        auto node = std::make_shared<TreeNode>("id", currentToken().value);
+        auto node = std::make_shared<TreeNode>(NodeKind::Id, currentToken().value);
+        node->line = currentToken().line;
         match("IDENTIFIER");
-        return node;
+        return intern(node);
     }
     if (currentToken().type == "OPENBRACKET") {
         match("OPENBRACKET");
         auto node = exp();
-        match("CLOSEDBRACKET");
+        if (!node || !match("CLOSEDBRACKET")) return nullptr;
         return node;
     }
 
-    throw runtime_error(
-        "Error at line " + to_string(currentToken().line) + " : Invalid factor \"" + currentToken().value + "\"");
+    const Token &token = tokens[currentTokenIndex];
+    return fail(Diagnostic{DiagnosticCode::InvalidFactor, token.line, token.column, token.value, ""});
 }
 
 
 shared_ptr<TreeNode> Parser :: parse() {
-    return program();
+    return tryParse().valueOrRaise();
+}
+
+Expected<shared_ptr<TreeNode>> Parser::tryParse() {
+    if (!fetch(0)) return Diagnostic{DiagnosticCode::NoTokens, 0, 0, "", ""};
+    auto node = program();
+    if (failed) return error;
+    return node;
+}
+
+shared_ptr<TreeNode> Parser::parseChunk(size_t start, bool bounded) {
+    currentTokenIndex = start;
+    auto node = bounded ? boundedSequence() : stmt_sequence();
+    if (failed) raiseDiagnostic(error);
+    return node;
+}
+
+// Statements up to, not including, the last token
+shared_ptr<TreeNode> Parser::boundedSequence() {
+    auto node = std::make_shared<TreeNode>(NodeKind::Seq);
+    node->line = currentToken().line;
+    auto first = statement();
+    if (!first) return nullptr;
+    node->children.push_back(first);
+    while (currentTokenIndex < tokens.size() - 1 && currentToken().type == "SEMICOLON") {
+        match("SEMICOLON");
+        auto next = statement();
+        if (!next) return nullptr;
+        node->children.push_back(next);
+    }
+    return node;
+}
+
+void Parser::setMonitor(ParseMonitor *monitor) {
+    this->monitor = monitor;
+}
+
+void Parser::setInterner(ExpressionInterner *interner) {
+    this->interner = interner;
+}
+
+bool Parser::atLastToken() const {
+    return currentTokenIndex == tokens.size() - 1;
+}
+
+std::vector<Token> Parser::releaseTokens() {
+    return std::move(tokens);
 }
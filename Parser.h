@@ -1,17 +1,32 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
+#include "Diagnostic.h"
+#include "ExpressionInterner.h"
 #include "Token.h"
 #include "TreeNode.h"
 
 using namespace std;
 
+// Lets another thread follow a running parse and stop it
+struct ParseMonitor {
+    std::atomic<bool> cancelled{false};
+    std::atomic<size_t> position{0}; // index of the statement being parsed
+};
+
 class Parser {
 private:
     std::vector<Token> tokens;
     size_t currentTokenIndex;
+    ParseMonitor *monitor = nullptr;
+    ExpressionInterner *interner = nullptr;
+    std::function<bool(std::vector<Token>&)> source; // appends the next batch, false once exhausted
+    bool failed = false;
+    Diagnostic error; // the first error, once failed
 
     shared_ptr<TreeNode> program();
     shared_ptr<TreeNode> stmt_sequence();
@@ -25,14 +40,38 @@ private:
     shared_ptr<TreeNode> simple_exp();
     shared_ptr<TreeNode> term();
     shared_ptr<TreeNode> factor();
+    shared_ptr<TreeNode> boundedSequence();
 
-    void match(const std::string& expectedType);
+    shared_ptr<TreeNode> fail(Diagnostic diagnostic);
+    bool match(const std::string& expectedType);
     Token currentToken();
     void advance();
+    bool fetch(size_t index);
+    shared_ptr<TreeNode> intern(shared_ptr<TreeNode> node);
 
 public:
     explicit Parser(const std::vector<Token>& tokens);
+    explicit Parser(std::vector<Token>&& tokens);
+    // Pulls tokens from `source` only when the parse reaches them, so scanning can still be running
+    explicit Parser(std::function<bool(std::vector<Token>&)> source);
+    // Parses the whole program; on failure returns the Diagnostic instead of throwing,
+    // a syntax error or DiagnosticCode::Cancelled when the monitor cancels
+    Expected<shared_ptr<TreeNode>> tryParse();
+    // tryParse() that raises its diagnostic: runtime_error or ParseCancelled, or
+    // print-and-abort under TINY_NO_EXCEPTIONS
     shared_ptr<TreeNode> parse();
+    void setMonitor(ParseMonitor *monitor);
+    // Shares repeated expression subtrees through `interner`; null turns it off
+    void setInterner(ExpressionInterner *interner);
+
+    // Parses a run of top-level statements starting at token `start`, throwing like
+    // parse(). When `bounded`, the last token is the SEMICOLON that ends the run and
+    // is left unconsumed.
+    shared_ptr<TreeNode> parseChunk(size_t start, bool bounded);
+    bool atLastToken() const;
+
+    // Every token pulled so far; the parser is unusable afterwards
+    std::vector<Token> releaseTokens();
 };
 
 #endif // PARSER_H
@@ -0,0 +1,165 @@
+#include "PartialEvaluator.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+bool isJump(const Instruction &instruction) {
+    return instruction.op == OpCode::Jump || instruction.op == OpCode::JumpIfFalse;
+}
+
+Instruction constant(int dst, int64_t value) {
+    Instruction instruction{OpCode::Const};
+    instruction.dst = dst;
+    instruction.value = value;
+    return instruction;
+}
+
+class PartialEvaluator {
+public:
+    explicit PartialEvaluator(Program &program)
+        : program(program), registers(static_cast<size_t>(max(program.registerCount, 1)), 0) {}
+
+    PartialEvaluationStats run(uint64_t maxSteps, chrono::nanoseconds timeout) {
+        auto deadline = chrono::steady_clock::now() + timeout;
+        size_t pc = 0;
+        bool stopped = false;
+        while (!stopped && stats.steps < maxSteps) {
+            if (step(pc)) {
+                stats.steps++;
+            } else {
+                stopped = true;
+            }
+            // The clock is looked at as seldom as the VirtualMachine does
+            if (timeout.count() > 0 && stats.steps % 4096 == 0 && chrono::steady_clock::now() >= deadline) break;
+        }
+        if (stopped && !stats.finished) stats.stopLine = program.code[pc].line;
+        if (stats.steps > 0) rewrite(pc);
+        return stats;
+    }
+
+private:
+    Program &program;
+    vector<int64_t> registers;
+    vector<int64_t> outputs;
+    PartialEvaluationStats stats;
+
+    // Runs the instruction at `pc` like the VirtualMachine and moves on; false, with
+    // `pc` left on it, for a read, a halt and an instruction that would fail
+    bool step(size_t &pc) {
+        const Instruction &instruction = program.code[pc];
+        int64_t *r = registers.data();
+        int64_t a = r[instruction.a], b = r[instruction.b];
+        uint64_t ua = static_cast<uint64_t>(a), ub = static_cast<uint64_t>(b);
+        int64_t result = 0;
+        switch (instruction.op) {
+            case OpCode::Const:
+                result = instruction.value;
+                break;
+            case OpCode::Move:
+                result = a;
+                break;
+            case OpCode::Add:
+                result = static_cast<int64_t>(ua + ub);
+                break;
+            case OpCode::Sub:
+                result = static_cast<int64_t>(ua - ub);
+                break;
+            case OpCode::Mul:
+                result = static_cast<int64_t>(ua * ub);
+                break;
+            case OpCode::Div:
+                if (b == 0) return false;
+                result = b == -1 ? static_cast<int64_t>(0 - ua) : a / b;
+                break;
+            case OpCode::AddChecked:
+                if (__builtin_add_overflow(a, b, &result)) return false;
+                break;
+            case OpCode::SubChecked:
+                if (__builtin_sub_overflow(a, b, &result)) return false;
+                break;
+            case OpCode::MulChecked:
+                if (__builtin_mul_overflow(a, b, &result)) return false;
+                break;
+            case OpCode::DivChecked:
+                if (b == 0 || (b == -1 && a == INT64_MIN)) return false;
+                result = a / b;
+                break;
+            case OpCode::DivUnchecked:
+                result = a / b;
+                break;
+            case OpCode::Less:
+                result = a < b;
+                break;
+            case OpCode::Equal:
+                result = a == b;
+                break;
+            case OpCode::Read:
+                return false;
+            case OpCode::Write:
+                outputs.push_back(a);
+                pc++;
+                return true;
+            case OpCode::Jump:
+                pc = static_cast<size_t>(instruction.target);
+                return true;
+            case OpCode::JumpIfFalse:
+                pc = a == 0 ? static_cast<size_t>(instruction.target) : pc + 1;
+                return true;
+            case OpCode::Halt:
+                stats.finished = true;
+                return false;
+        }
+        r[instruction.dst] = result;
+        pc++;
+        return true;
+    }
+
+    // Puts the outcome of the prefix in front of the code and jumps to `stop`
+    void rewrite(size_t stop) {
+        vector<Instruction> prologue;
+        // After a halt only the variables can still be looked at
+        size_t restored = stats.finished ? program.variables.size() : static_cast<size_t>(program.registerCount);
+        for (size_t r = 0; r < restored; ++r) {
+            if (registers[r] != 0) prologue.push_back(constant(static_cast<int>(r), registers[r]));
+        }
+
+        // Values written go through one scratch register past the program's own
+        if (!outputs.empty()) {
+            int scratch = program.registerCount++;
+            for (int64_t value: outputs) {
+                prologue.push_back(constant(scratch, value));
+                Instruction write{OpCode::Write};
+                write.a = scratch;
+                prologue.push_back(write);
+            }
+        }
+        stats.outputs = outputs.size();
+
+        size_t offset = prologue.size() + 1;
+        Instruction jump{OpCode::Jump};
+        jump.target = static_cast<int>(stop + offset);
+        prologue.push_back(jump);
+
+        for (Instruction &instruction: program.code) {
+            if (isJump(instruction)) instruction.target += static_cast<int>(offset);
+        }
+        for (size_t s = 1; s < program.statements.size(); ++s) {
+            StatementInfo &statement = program.statements[s];
+            statement.entry += offset;
+            if (statement.kind == NodeKind::Repeat) statement.test += offset;
+        }
+        program.code.insert(program.code.begin(), prologue.begin(), prologue.end());
+        stats.prologue = prologue.size();
+    }
+};
+
+} // namespace
+
+PartialEvaluationStats partialEvaluate(Program &program, uint64_t maxSteps, chrono::nanoseconds timeout) {
+    PartialEvaluator evaluator(program);
+    return evaluator.run(maxSteps, timeout);
+}
@@ -0,0 +1,33 @@
+#ifndef PARTIALEVALUATOR_H
+#define PARTIALEVALUATOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "CodeGenerator.h"
+
+using namespace std;
+
+struct PartialEvaluationStats {
+    uint64_t steps = 0;    // instructions run at compile time
+    size_t outputs = 0;    // values they wrote, now written by constants
+    bool finished = false; // the program halted: its whole output is precomputed
+    int stopLine = 0;      // line of the read or failing instruction left to run time, 0 for neither
+    size_t prologue = 0;   // instructions put in front of the code, the jump included
+};
+
+// Runs a program at compile time up to its first read statement, runtime error,
+// halt, `maxSteps` instructions or `timeout` (0 for none). That prefix does not depend on the input, so
+// the program is rewritten to start with its outcome: constants for the values it
+// wrote and for every register it left nonzero, then a jump to where it stopped.
+// A program without reads thus becomes its precomputed output. The rest of the
+// code is kept as it is; an error the prefix ran into is still raised at run
+// time, by the instruction that raised it.
+// Runs after optimizeLoops: restored temporaries are written more than once, and
+// the jump can enter a loop from the side. Steps run at compile time are not
+// counted when the program runs, the prologue's are: a caller enforcing a step
+// limit charges `steps` and refunds `prologue`.
+PartialEvaluationStats partialEvaluate(Program &program, uint64_t maxSteps,
+                                       chrono::nanoseconds timeout = chrono::nanoseconds(0));
+
+#endif // PARTIALEVALUATOR_H
@@ -0,0 +1,186 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const char *perfEventName(PerfEvent event) {
+    static const char *names[] = {"cycles", "instructions", "branch-misses", "L1d-misses", "LLC-misses"};
+    return names[static_cast<int>(event)];
+}
+
+namespace {
+
+#ifdef __linux__
+
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventConfig eventConfigs[perfEventCount] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+int openEvent(const EventConfig &event) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Worker threads of the parallel scanner and parser count with the thread that started them
+    attr.inherit = 1;
+    // With more events than hardware counters the kernel time-shares them
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+// Count scaled up to the whole time the event was enabled
+bool readEvent(int fd, uint64_t &value) {
+    uint64_t data[3] = {};
+    if (read(fd, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) return false;
+    value = data[2] == data[1] ? data[0] : static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+    return true;
+}
+
+#endif
+
+// value / units with three decimals
+string perUnit(double value, size_t units) {
+    ostringstream text;
+    text << fixed << setprecision(3) << value / static_cast<double>(units);
+    return text.str();
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+    for (int &fd: fds) fd = -1;
+#ifdef __linux__
+    for (size_t e = 0; e < perfEventCount; ++e) {
+        fds[e] = openEvent(eventConfigs[e]);
+        if (fds[e] < 0 && reason.empty()) reason = string("perf_event_open: ") + strerror(errno);
+    }
+#else
+    reason = "hardware counters are only read on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int fd: fds) {
+        if (fd >= 0) close(fd);
+    }
+#endif
+}
+
+bool PerfCounters::available() const {
+    for (int fd: fds) {
+        if (fd >= 0) return true;
+    }
+    return false;
+}
+
+void PerfCounters::start() {
+#ifdef __linux__
+    for (int fd: fds) {
+        if (fd < 0) continue;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+    started = chrono::steady_clock::now();
+}
+
+PerfSample PerfCounters::stop() {
+    PerfSample sample;
+    sample.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - started).count();
+#ifdef __linux__
+    for (size_t e = 0; e < perfEventCount; ++e) {
+        if (fds[e] < 0) continue;
+        ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+        sample.counted[e] = readEvent(fds[e], sample.values[e]);
+    }
+#endif
+    return sample;
+}
+
+PhaseCounters::PhaseCounters(bool enabled) {
+    if (enabled) counters = make_unique<PerfCounters>();
+}
+
+void PhaseCounters::begin() {
+    if (counters) counters->start();
+}
+
+void PhaseCounters::end(const string &phase, size_t units, const string &unit) {
+    if (counters) phases.push_back({phase, units, unit, counters->stop()});
+}
+
+void PhaseCounters::setUnits(const string &phase, size_t units) {
+    for (PhaseSample &p: phases) {
+        if (p.phase == phase) p.units = units;
+    }
+}
+
+void PhaseCounters::write(ostream &out) const {
+    if (!counters) return;
+    ios::fmtflags flags = out.flags();
+    if (!counters->available()) {
+        out << "Hardware counters unavailable (" << counters->unavailableReason() << "); wall time only" << endl;
+    }
+
+    out << left << setw(12) << "phase" << right << setw(12) << "units" << setw(12) << "ms";
+    for (size_t e = 0; e < perfEventCount; ++e) out << setw(15) << perfEventName(static_cast<PerfEvent>(e));
+    out << setw(8) << "IPC" << endl;
+    for (const PhaseSample &p: phases) {
+        out << left << setw(12) << p.phase << right << setw(12) << p.units << setw(12) << fixed << setprecision(3)
+            << p.sample.milliseconds;
+        for (size_t e = 0; e < perfEventCount; ++e) {
+            if (p.sample.counted[e]) {
+                out << setw(15) << p.sample.values[e];
+            } else {
+                out << setw(15) << "n/a";
+            }
+        }
+        if (p.sample.has(PerfEvent::Cycles) && p.sample.has(PerfEvent::Instructions) && p.sample[PerfEvent::Cycles] > 0) {
+            out << setw(8) << setprecision(2)
+                << static_cast<double>(p.sample[PerfEvent::Instructions]) / static_cast<double>(p.sample[PerfEvent::Cycles]);
+        } else {
+            out << setw(8) << "n/a";
+        }
+        out << endl;
+    }
+
+    out << endl << "Per unit" << endl;
+    for (const PhaseSample &p: phases) {
+        if (p.units == 0) continue;
+        out << left << setw(12) << p.phase << setw(16) << ("per " + p.unit) << right;
+        out << setw(12) << perUnit(p.sample.milliseconds * 1e6, p.units) << " ns";
+        for (size_t e = 0; e < perfEventCount; ++e) {
+            if (p.sample.counted[e]) {
+                out << "  " << perfEventName(static_cast<PerfEvent>(e)) << " "
+                    << perUnit(static_cast<double>(p.sample.values[e]), p.units);
+            }
+        }
+        out << endl;
+    }
+    out.flags(flags);
+}
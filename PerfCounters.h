@@ -0,0 +1,82 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+enum class PerfEvent { Cycles, Instructions, BranchMisses, L1DMisses, LLCMisses };
+
+constexpr size_t perfEventCount = 5;
+
+const char *perfEventName(PerfEvent event);
+
+struct PerfSample {
+    double milliseconds = 0;
+    uint64_t values[perfEventCount] = {};
+    bool counted[perfEventCount] = {}; // false when the event could not be opened
+
+    bool has(PerfEvent event) const { return counted[static_cast<size_t>(event)]; }
+    uint64_t operator[](PerfEvent event) const { return values[static_cast<size_t>(event)]; }
+};
+
+// Hardware counters of the calling thread and of the threads it starts after the
+// counters are opened, through perf_event_open on Linux. Only user-space events
+// are counted. Events the kernel or the CPU does not offer are
+// left out, and elsewhere only the wall time is measured.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    // Whether at least one hardware event could be opened; `reason` says why not
+    bool available() const;
+    const string &unavailableReason() const { return reason; }
+
+    void start();
+    PerfSample stop();
+
+private:
+    int fds[perfEventCount];
+    string reason;
+    chrono::steady_clock::time_point started;
+};
+
+// A measured compiler phase; `units` is what the per-unit ratios divide by
+struct PhaseSample {
+    string phase;
+    size_t units;
+    string unit; // "token", "node", ...
+    PerfSample sample;
+};
+
+// Measures the phases of one compilation in turn. A disabled PhaseCounters
+// opens no counters and records nothing.
+class PhaseCounters {
+public:
+    explicit PhaseCounters(bool enabled);
+
+    bool enabled() const { return counters != nullptr; }
+
+    void begin();
+    void end(const string &phase, size_t units, const string &unit);
+    // Sets the units of a recorded phase, for counts taken after it ended
+    void setUnits(const string &phase, size_t units);
+
+    // Table of time, counts and IPC per phase, then the counts per unit
+    void write(ostream &out) const;
+
+private:
+    unique_ptr<PerfCounters> counters;
+    vector<PhaseSample> phases;
+};
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,74 @@
+#include "Pipeline.h"
+#include "Scanner.h"
+#include "Parser.h"
+#include "SpscRing.h"
+#include <exception>
+#include <iterator>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+const size_t batchSize = 1024;   // tokens per ring slot
+const size_t ringCapacity = 64;  // batches the scanner may run ahead
+
+void append(vector<Token> &tokens, vector<Token> &batch) {
+    tokens.insert(tokens.end(), make_move_iterator(batch.begin()), make_move_iterator(batch.end()));
+}
+
+} // namespace
+
+shared_ptr<TreeNode> parsePipelined(istream &in, vector<Token> &tokens) {
+    SpscRing<vector<Token>> ring(ringCapacity);
+    exception_ptr scanError;
+    bool commentState = inComment;
+
+    thread scanner([&] {
+        try {
+            vector<Token> batch;
+            int lineCount = 1;
+            string line;
+            while (getline(in, line)) {
+                vector<Token> lineTokens = tokenize(line, lineCount++, commentState);
+                append(batch, lineTokens);
+                if (batch.size() >= batchSize) {
+                    ring.push(move(batch));
+                    batch.clear();
+                }
+            }
+            if (!batch.empty()) ring.push(move(batch));
+        } catch (...) {
+            scanError = current_exception();
+        }
+        ring.close();
+    });
+
+    Parser parser([&ring](vector<Token> &parsed) {
+        vector<Token> batch;
+        if (!ring.pop(batch)) return false;
+        append(parsed, batch);
+        return true;
+    });
+
+    shared_ptr<TreeNode> syntaxTree;
+    exception_ptr parseError;
+    try {
+        syntaxTree = parser.parse();
+    } catch (...) {
+        parseError = current_exception();
+    }
+
+    // The parser stops early on an error or on trailing tokens; keep draining so the
+    // scanner finishes and every token is reported
+    tokens = parser.releaseTokens();
+    vector<Token> batch;
+    while (ring.pop(batch)) append(tokens, batch);
+    scanner.join();
+    inComment = commentState;
+
+    if (scanError) rethrow_exception(scanError);
+    if (parseError) rethrow_exception(parseError);
+    return syntaxTree;
+}
@@ -0,0 +1,20 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <istream>
+#include <memory>
+#include <vector>
+#include "Token.h"
+#include "TreeNode.h"
+
+using namespace std;
+
+// Scans `in` line by line on a separate thread while the recursive descent Parser
+// consumes the tokens on the calling thread. Batches of tokens travel through a
+// bounded SpscRing, so a scanner that runs ahead waits for the parser.
+// Errors are the same as scanning fully and then parsing: a scan error wins over a
+// parse error. Every scanned token is moved into `tokens`, also when an error is
+// thrown. Starts from and updates the global inComment.
+shared_ptr<TreeNode> parsePipelined(istream &in, vector<Token> &tokens);
+
+#endif // PIPELINE_H
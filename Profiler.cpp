@@ -0,0 +1,111 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+
+// How many times each statement started; a repeat starts once per entry, not per iteration
+vector<uint64_t> statementExecutions(const Program &program, const ExecutionProfile &profile) {
+    vector<uint64_t> executions(program.statements.size(), 0);
+    for (size_t s = 1; s < program.statements.size(); ++s) {
+        const StatementInfo &statement = program.statements[s];
+        executions[s] = profile.counts[statement.entry];
+        if (statement.kind == NodeKind::Repeat) executions[s] -= profile.taken[statement.test];
+    }
+    return executions;
+}
+
+// Own time plus the time of every nested statement
+vector<uint64_t> inclusiveNanos(const Program &program, const ExecutionProfile &profile) {
+    vector<uint64_t> inclusive = profile.statementNanos;
+    for (size_t s = program.statements.size(); s-- > 1;) {
+        inclusive[static_cast<size_t>(program.statements[s].parent)] += inclusive[s];
+    }
+    return inclusive;
+}
+
+double milliseconds(uint64_t nanos) {
+    return static_cast<double>(nanos) / 1e6;
+}
+
+} // namespace
+
+StatementProfiler::StatementProfiler(const Program &program) : code(program.code.data()) {
+    profile.counts.assign(program.code.size(), 0);
+    profile.taken.assign(program.code.size(), 0);
+    profile.statementNanos.assign(program.statements.size(), 0);
+    last = Clock::now();
+}
+
+ExecutionProfile StatementProfiler::finish() {
+    Clock::time_point now = Clock::now();
+    profile.statementNanos[current] += static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(now - last).count());
+    last = now;
+    return profile;
+}
+
+void writeAnnotatedListing(const Program &program, const ExecutionProfile &profile,
+                           const vector<string> &source, ostream &out) {
+    vector<uint64_t> executions = statementExecutions(program, profile);
+    vector<uint64_t> inclusive = inclusiveNanos(program, profile);
+
+    // A line shows its busiest statement's count and the own time of all its statements
+    vector<uint64_t> lineCount(source.size() + 1, 0);
+    vector<uint64_t> lineNanos(source.size() + 1, 0);
+    vector<bool> hasStatement(source.size() + 1, false);
+    for (size_t s = 1; s < program.statements.size(); ++s) {
+        size_t line = static_cast<size_t>(program.statements[s].line);
+        if (line == 0 || line > source.size()) continue;
+        hasStatement[line] = true;
+        lineCount[line] = max(lineCount[line], executions[s]);
+        lineNanos[line] += profile.statementNanos[s];
+    }
+
+    out << fixed << setprecision(3);
+    out << setw(12) << "count" << setw(12) << "ms" << "  line | source\n";
+    for (size_t line = 1; line <= source.size(); ++line) {
+        if (hasStatement[line]) {
+            out << setw(12) << lineCount[line] << setw(12) << milliseconds(lineNanos[line]);
+        } else {
+            out << setw(24) << "";
+        }
+        out << setw(6) << line << " | " << source[line - 1] << '\n';
+    }
+
+    vector<size_t> loops;
+    for (size_t s = 1; s < program.statements.size(); ++s) {
+        if (program.statements[s].kind == NodeKind::Repeat && executions[s] + profile.counts[program.statements[s].test] > 0) {
+            loops.push_back(s);
+        }
+    }
+    sort(loops.begin(), loops.end(), [&](size_t a, size_t b) { return inclusive[a] > inclusive[b]; });
+
+    uint64_t total = max<uint64_t>(inclusive[0], 1);
+    out << "\nHot loops (total " << milliseconds(inclusive[0]) << " ms)\n";
+    if (loops.empty()) out << "  none executed\n";
+    for (size_t s: loops) {
+        const StatementInfo &loop = program.statements[s];
+        out << "  repeat at line " << loop.line << " : " << setprecision(1)
+            << 100.0 * static_cast<double>(inclusive[s]) / static_cast<double>(total) << "% of the run, "
+            << setprecision(3) << milliseconds(inclusive[s]) << " ms, " << profile.counts[loop.test]
+            << " iterations in " << executions[s] << (executions[s] == 1 ? " entry\n" : " entries\n");
+    }
+}
+
+void writeFoldedStacks(const Program &program, const ExecutionProfile &profile, ostream &out) {
+    for (size_t s = 0; s < program.statements.size(); ++s) {
+        if (profile.statementNanos[s] == 0) continue;
+        vector<size_t> stack;
+        for (int frame = static_cast<int>(s); frame > 0; frame = program.statements[frame].parent) {
+            stack.push_back(static_cast<size_t>(frame));
+        }
+        out << "program";
+        for (size_t i = stack.size(); i-- > 0;) {
+            const StatementInfo &statement = program.statements[stack[i]];
+            out << ';' << kindName(statement.kind) << '@' << statement.line;
+        }
+        out << ' ' << profile.statementNanos[s] << '\n';
+    }
+}
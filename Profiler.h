@@ -0,0 +1,67 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "CodeGenerator.h"
+
+using namespace std;
+
+struct ExecutionProfile {
+    vector<uint64_t> counts;         // executions of each instruction
+    vector<uint64_t> taken;          // jumps taken by each JumpIfFalse
+    vector<uint64_t> statementNanos; // time spent in each statement's own instructions
+};
+
+// Execution policies for VirtualMachine::execute. NoProfiling compiles to nothing;
+// StatementProfiler counts instructions and charges the time between two
+// statement changes to the statement that was running.
+struct NoProfiling {
+    void instruction(size_t) {}
+    void jumpTaken(size_t) {}
+};
+
+class StatementProfiler {
+public:
+    explicit StatementProfiler(const Program &program);
+
+    void instruction(size_t pc) {
+        profile.counts[pc]++;
+        int statement = code[pc].statement;
+        if (statement != current) {
+            Clock::time_point now = Clock::now();
+            profile.statementNanos[current] += static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(now - last).count());
+            last = now;
+            current = statement;
+        }
+    }
+
+    void jumpTaken(size_t pc) {
+        profile.taken[pc]++;
+    }
+
+    ExecutionProfile finish();
+
+private:
+    using Clock = chrono::steady_clock;
+
+    const Instruction *code;
+    ExecutionProfile profile;
+    int current = 0;
+    Clock::time_point last;
+};
+
+// Source listing with executions and time per line, followed by the repeat
+// loops ordered by the time spent inside them. `source` holds the program text,
+// one entry per line.
+void writeAnnotatedListing(const Program &program, const ExecutionProfile &profile,
+                           const vector<string> &source, ostream &out);
+
+// One "program;repeat@5;assign@6 nanoseconds" line per statement that took time,
+// for flame graph tools
+void writeFoldedStacks(const Program &program, const ExecutionProfile &profile, ostream &out);
+
+#endif // PROFILER_H
@@ -0,0 +1,421 @@
+#include "RangeAnalysis.h"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+
+using namespace std;
+
+namespace {
+
+using Wide = __int128;
+
+// Values a register may hold; empty when low > high
+struct Range {
+    int64_t low;
+    int64_t high;
+
+    bool empty() const { return low > high; }
+    bool contains(int64_t value) const { return low <= value && value <= high; }
+    bool operator!=(const Range &other) const { return low != other.low || high != other.high; }
+};
+
+const Range everything{INT64_MIN, INT64_MAX};
+
+Range hull(const Range &a, const Range &b) {
+    return {min(a.low, b.low), max(a.high, b.high)};
+}
+
+// A result computed exactly, cut to 64 bits; `fits` tells whether nothing was cut
+Range fromWide(Wide low, Wide high, bool &fits) {
+    fits = low >= INT64_MIN && high <= INT64_MAX;
+    return {static_cast<int64_t>(max<Wide>(low, INT64_MIN)), static_cast<int64_t>(min<Wide>(high, INT64_MAX))};
+}
+
+Range product(const Range &a, const Range &b, bool &fits) {
+    Wide corners[] = {Wide(a.low) * b.low, Wide(a.low) * b.high, Wide(a.high) * b.low, Wide(a.high) * b.high};
+    return fromWide(*min_element(corners, corners + 4), *max_element(corners, corners + 4), fits);
+}
+
+// Truncating division over the nonzero part of the divisor. For a divisor of one
+// sign the quotient is monotonic in both operands, so the corners bound it.
+Range quotient(const Range &a, const Range &d, bool &fits) {
+    Wide low = 0, high = 0;
+    bool any = false;
+    Range parts[] = {{d.low, min<int64_t>(d.high, -1)}, {max<int64_t>(d.low, 1), d.high}};
+    for (const Range &part: parts) {
+        if (part.empty()) continue;
+        Wide corners[] = {Wide(a.low) / part.low, Wide(a.low) / part.high, Wide(a.high) / part.low,
+                          Wide(a.high) / part.high};
+        Wide partLow = *min_element(corners, corners + 4), partHigh = *max_element(corners, corners + 4);
+        low = any ? min(low, partLow) : partLow;
+        high = any ? max(high, partHigh) : partHigh;
+        any = true;
+    }
+    if (!any) {
+        fits = true;
+        return everything; // always fails
+    }
+    return fromWide(low, high, fits);
+}
+
+// `range` without `value` where that is one of its ends
+Range exclude(Range range, int64_t value) {
+    if (range.low == value && range.high == value) return {INT64_MAX, INT64_MIN};
+    if (range.low == value) range.low++;
+    else if (range.high == value) range.high--;
+    return range;
+}
+
+bool writesRegister(OpCode op) {
+    return op != OpCode::Write && op != OpCode::Jump && op != OpCode::JumpIfFalse && op != OpCode::Halt;
+}
+
+class RangeAnalysis {
+public:
+    explicit RangeAnalysis(Program &program)
+        : code(program.code), variableCount(program.variables.size()),
+          current(static_cast<size_t>(program.registerCount)), writtenIn(current.size(), 0) {}
+
+    RangeAnalysisStats run() {
+        for (const Instruction &instruction: code) {
+            if (instruction.op == OpCode::Div) stats.zeroChecks++;
+            if (instruction.op == OpCode::DivChecked) stats.zeroChecks++, stats.overflowChecks++;
+            if (instruction.op == OpCode::AddChecked || instruction.op == OpCode::SubChecked ||
+                instruction.op == OpCode::MulChecked) {
+                stats.overflowChecks++;
+            }
+        }
+        if (stats.zeroChecks + stats.overflowChecks == 0) return stats;
+        findBlocks();
+        if (blocks.size() * variableCount > maxCells) return stats;
+        findThresholds();
+        solve();
+        for (int round = 0; round < narrowingRounds; ++round) narrow();
+        removeChecks();
+        return stats;
+    }
+
+private:
+    static constexpr size_t maxCells = size_t(1) << 22;
+    static constexpr int narrowingRounds = 2;
+
+    struct Block {
+        size_t begin;
+        size_t end; // one past the last instruction
+        bool loopHead = false;
+    };
+
+    vector<Instruction> &code;
+    size_t variableCount;
+    RangeAnalysisStats stats;
+
+    vector<Block> blocks;
+    vector<size_t> blockAt; // block of every instruction
+    vector<int64_t> thresholds;
+    vector<vector<Range>> entry; // variable ranges where each block starts
+    vector<bool> reachable;
+
+    // Registers while a block runs; temporaries not written in this run read as everything
+    vector<Range> current;
+    vector<size_t> writtenIn;
+    size_t generation = 0;
+    bool alive = true;
+    vector<OpCode> replacement; // filled by the last pass
+
+    void findBlocks() {
+        vector<bool> leader(code.size() + 1, false);
+        leader[0] = true;
+        for (size_t i = 0; i < code.size(); ++i) {
+            OpCode op = code[i].op;
+            if (op == OpCode::Jump || op == OpCode::JumpIfFalse) {
+                leader[static_cast<size_t>(code[i].target)] = true;
+                leader[i + 1] = true;
+            } else if (op == OpCode::Halt) {
+                leader[i + 1] = true;
+            }
+        }
+        blockAt.resize(code.size());
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (leader[i]) blocks.push_back({i, i + 1});
+            blocks.back().end = i + 1;
+            blockAt[i] = blocks.size() - 1;
+        }
+        for (size_t i = 0; i < code.size(); ++i) {
+            OpCode op = code[i].op;
+            if ((op == OpCode::Jump || op == OpCode::JumpIfFalse) && static_cast<size_t>(code[i].target) <= i) {
+                blocks[blockAt[static_cast<size_t>(code[i].target)]].loopHead = true;
+            }
+        }
+    }
+
+    // Widening stops at the constants of the program and their neighbours
+    void findThresholds() {
+        set<int64_t> values{INT64_MIN, -1, 0, 1, INT64_MAX};
+        for (const Instruction &instruction: code) {
+            if (instruction.op != OpCode::Const) continue;
+            values.insert(instruction.value);
+            if (instruction.value > INT64_MIN) values.insert(instruction.value - 1);
+            if (instruction.value < INT64_MAX) values.insert(instruction.value + 1);
+        }
+        thresholds.assign(values.begin(), values.end());
+    }
+
+    Range widen(const Range &old, const Range &joined) const {
+        Range result = joined;
+        if (joined.low < old.low) result.low = *prev(upper_bound(thresholds.begin(), thresholds.end(), joined.low));
+        if (joined.high > old.high) result.high = *lower_bound(thresholds.begin(), thresholds.end(), joined.high);
+        return result;
+    }
+
+    vector<Range> initialState() const {
+        return vector<Range>(variableCount, Range{0, 0});
+    }
+
+    // Worklist iteration to a fixpoint, lowest block first
+    void solve() {
+        entry.assign(blocks.size(), vector<Range>());
+        reachable.assign(blocks.size(), false);
+        entry[0] = initialState();
+        reachable[0] = true;
+        set<size_t> pending{0};
+        while (!pending.empty()) {
+            size_t block = *pending.begin();
+            pending.erase(pending.begin());
+            execute(block, [&](size_t target, const vector<Range> &state) {
+                if (merge(target, state)) pending.insert(target);
+            });
+        }
+    }
+
+    bool merge(size_t block, const vector<Range> &state) {
+        if (!reachable[block]) {
+            reachable[block] = true;
+            entry[block] = state;
+            return true;
+        }
+        bool changed = false;
+        for (size_t v = 0; v < variableCount; ++v) {
+            Range joined = hull(entry[block][v], state[v]);
+            if (blocks[block].loopHead) joined = widen(entry[block][v], joined);
+            if (joined != entry[block][v]) {
+                entry[block][v] = joined;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    // One round of recomputing every entry from the others without widening; starting
+    // from a fixpoint, each round stays sound and can only get tighter
+    void narrow() {
+        vector<vector<Range>> next(blocks.size());
+        vector<bool> nextReachable(blocks.size(), false);
+        next[0] = initialState();
+        nextReachable[0] = true;
+        for (size_t block = 0; block < blocks.size(); ++block) {
+            if (!reachable[block]) continue;
+            execute(block, [&](size_t target, const vector<Range> &state) {
+                if (!nextReachable[target]) {
+                    nextReachable[target] = true;
+                    next[target] = state;
+                    return;
+                }
+                for (size_t v = 0; v < variableCount; ++v) next[target][v] = hull(next[target][v], state[v]);
+            });
+        }
+        entry = move(next);
+        reachable = move(nextReachable);
+    }
+
+    void removeChecks() {
+        replacement.resize(code.size());
+        for (size_t i = 0; i < code.size(); ++i) replacement[i] = code[i].op;
+        for (size_t block = 0; block < blocks.size(); ++block) {
+            if (reachable[block]) execute(block, [](size_t, const vector<Range> &) {});
+        }
+        for (size_t i = 0; i < code.size(); ++i) {
+            OpCode before = code[i].op, after = replacement[i];
+            if (before == after) continue;
+            if (before == OpCode::Div || (before == OpCode::DivChecked && after == OpCode::DivUnchecked)) {
+                stats.zeroChecksRemoved++;
+            }
+            if (before != OpCode::Div) stats.overflowChecksRemoved++;
+            code[i].op = after;
+        }
+    }
+
+    Range value(int reg) const {
+        size_t index = static_cast<size_t>(reg);
+        if (index < variableCount || writtenIn[index] == generation) return current[index];
+        return everything;
+    }
+
+    void store(int reg, const Range &range) {
+        size_t index = static_cast<size_t>(reg);
+        current[index] = range;
+        writtenIn[index] = generation;
+    }
+
+    // Runs `block` from its entry state, passing the variable ranges on every way out to `edge`
+    template<typename Edge>
+    void execute(size_t block, Edge edge) {
+        generation++;
+        alive = true;
+        copy(entry[block].begin(), entry[block].end(), current.begin());
+        size_t end = blocks[block].end;
+        for (size_t i = blocks[block].begin; i < end && alive; ++i) {
+            const Instruction &instruction = code[i];
+            switch (instruction.op) {
+                case OpCode::Jump:
+                    edge(blockAt[static_cast<size_t>(instruction.target)], variables());
+                    return;
+                case OpCode::JumpIfFalse: {
+                    vector<Range> state = variables();
+                    if (refine(i, false, state)) edge(blockAt[static_cast<size_t>(instruction.target)], state);
+                    state = variables();
+                    if (refine(i, true, state) && i + 1 < code.size()) edge(blockAt[i + 1], state);
+                    return;
+                }
+                case OpCode::Halt:
+                    return;
+                default:
+                    step(i);
+            }
+        }
+        if (alive && end < code.size()) edge(blockAt[end], variables());
+    }
+
+    vector<Range> variables() const {
+        return vector<Range>(current.begin(), current.begin() + static_cast<ptrdiff_t>(variableCount));
+    }
+
+    void step(size_t i) {
+        const Instruction &instruction = code[i];
+        Range a = value(instruction.a), b = value(instruction.b);
+        bool fits = true;
+        switch (instruction.op) {
+            case OpCode::Const:
+                store(instruction.dst, {instruction.value, instruction.value});
+                break;
+            case OpCode::Move:
+                store(instruction.dst, a);
+                break;
+            case OpCode::Read:
+                store(instruction.dst, everything);
+                break;
+            case OpCode::Write:
+                break;
+            case OpCode::Add:
+            case OpCode::AddChecked: {
+                Range sum = fromWide(Wide(a.low) + b.low, Wide(a.high) + b.high, fits);
+                arithmetic(i, sum, fits);
+                break;
+            }
+            case OpCode::Sub:
+            case OpCode::SubChecked: {
+                Range difference = fromWide(Wide(a.low) - b.high, Wide(a.high) - b.low, fits);
+                arithmetic(i, difference, fits);
+                break;
+            }
+            case OpCode::Mul:
+            case OpCode::MulChecked: {
+                Range result = product(a, b, fits);
+                arithmetic(i, result, fits);
+                break;
+            }
+            case OpCode::Div:
+            case OpCode::DivChecked:
+            case OpCode::DivUnchecked:
+                divide(i, a, b);
+                break;
+            case OpCode::Less:
+                store(instruction.dst, a.high < b.low ? Range{1, 1} : a.low >= b.high ? Range{0, 0} : Range{0, 1});
+                break;
+            case OpCode::Equal:
+                if (a.low == a.high && b.low == b.high && a.low == b.low) store(instruction.dst, {1, 1});
+                else if (a.high < b.low || b.high < a.low) store(instruction.dst, {0, 0});
+                else store(instruction.dst, {0, 1});
+                break;
+            default:
+                break;
+        }
+    }
+
+    // After a checked operation the result fits, or the program has stopped
+    void arithmetic(size_t i, const Range &result, bool fits) {
+        const Instruction &instruction = code[i];
+        bool checked = instruction.op != OpCode::Add && instruction.op != OpCode::Sub && instruction.op != OpCode::Mul;
+        store(instruction.dst, fits || checked ? result : everything);
+        if (checked && fits && !replacement.empty()) {
+            replacement[i] = instruction.op == OpCode::AddChecked ? OpCode::Add
+                           : instruction.op == OpCode::SubChecked ? OpCode::Sub : OpCode::Mul;
+        }
+    }
+
+    void divide(size_t i, const Range &a, const Range &d) {
+        const Instruction &instruction = code[i];
+        bool fits = true;
+        Range result = quotient(a, d, fits);
+        if (d.low == 0 && d.high == 0) alive = false;
+        if (!replacement.empty() && instruction.op != OpCode::DivUnchecked) {
+            if (fits && !d.contains(0)) replacement[i] = OpCode::DivUnchecked;
+            else if (fits && instruction.op == OpCode::DivChecked) replacement[i] = OpCode::Div;
+        }
+        // INT64_MIN / -1 wraps back to INT64_MIN unless it is checked
+        store(instruction.dst, fits || instruction.op != OpCode::Div ? result : everything);
+        // Past the check the divisor is not 0
+        if (instruction.b != instruction.dst && instruction.op != OpCode::DivUnchecked) {
+            store(instruction.b, exclude(d, 0));
+        }
+    }
+
+    // Narrows `state` to the edge of the JumpIfFalse at `jump` taken when its condition
+    // is `truth`; false when that edge cannot be taken
+    bool refine(size_t jump, bool truth, vector<Range> &state) const {
+        int condition = code[jump].a;
+        Range tested = value(condition);
+        if (truth ? tested.low == 0 && tested.high == 0 : !tested.contains(0)) return false;
+
+        // The comparison computing the condition, with operands unchanged since
+        size_t begin = blocks[blockAt[jump]].begin, compare = jump;
+        for (size_t i = jump; i-- > begin;) {
+            if (writesRegister(code[i].op) && code[i].dst == condition) {
+                compare = i;
+                break;
+            }
+        }
+        if (compare == jump) return true;
+        const Instruction &test = code[compare];
+        if (test.op != OpCode::Less && test.op != OpCode::Equal) return true;
+        for (size_t i = compare + 1; i < jump; ++i) {
+            if (writesRegister(code[i].op) && (code[i].dst == test.a || code[i].dst == test.b)) return true;
+        }
+
+        if (test.a == test.b) return (test.op == OpCode::Equal) == truth;
+        Range x = value(test.a), y = value(test.b);
+        if (test.op == OpCode::Less && truth) {
+            if (y.high == INT64_MIN || x.low == INT64_MAX) return false;
+            x.high = min(x.high, y.high - 1);
+            y.low = max(y.low, x.low + 1);
+        } else if (test.op == OpCode::Less) {
+            x.low = max(x.low, y.low);
+            y.high = min(y.high, x.high);
+        } else if (truth) {
+            x = y = Range{max(x.low, y.low), min(x.high, y.high)};
+        } else {
+            if (y.low == y.high) x = exclude(x, y.low);
+            if (x.low == x.high) y = exclude(y, x.low);
+        }
+        if (x.empty() || y.empty()) return false;
+        if (static_cast<size_t>(test.a) < variableCount) state[static_cast<size_t>(test.a)] = x;
+        if (static_cast<size_t>(test.b) < variableCount) state[static_cast<size_t>(test.b)] = y;
+        return true;
+    }
+};
+
+} // namespace
+
+RangeAnalysisStats removeRedundantChecks(Program &program) {
+    RangeAnalysis analysis(program);
+    return analysis.run();
+}
@@ -0,0 +1,26 @@
+#ifndef RANGEANALYSIS_H
+#define RANGEANALYSIS_H
+
+#include <cstddef>
+#include "CodeGenerator.h"
+
+using namespace std;
+
+struct RangeAnalysisStats {
+    size_t zeroChecks = 0;            // divisions that test their divisor for 0
+    size_t zeroChecksRemoved = 0;
+    size_t overflowChecks = 0;        // checked + - * /
+    size_t overflowChecksRemoved = 0;
+};
+
+// Computes an interval for every variable at every point of a compiled program
+// and drops the runtime checks it proves cannot fire: a division whose divisor
+// cannot be 0 becomes DivUnchecked, a checked operation whose result always fits
+// becomes the plain one. Ranges come from constants, are narrowed along the two
+// edges of a comparison, and are widened to the program's own constants at loop
+// heads before a few rounds of narrowing. Results and runtime errors stay the
+// same. Runs before optimizeLoops; programs whose blocks times variables exceed
+// a few million are left alone.
+RangeAnalysisStats removeRedundantChecks(Program &program);
+
+#endif // RANGEANALYSIS_H
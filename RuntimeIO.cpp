@@ -0,0 +1,77 @@
+#include "RuntimeIO.h"
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+namespace {
+
+const size_t inputBlock = 1 << 16;
+
+bool isSpace(char c) {
+    return isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+} // namespace
+
+RuntimeInput::RuntimeInput(istream &in) : stream(&in) {
+    buffer.reserve(inputBlock);
+    pos = end = buffer.data();
+}
+
+RuntimeInput::RuntimeInput(string text) : buffer(move(text)) {
+    pos = buffer.data();
+    end = pos + buffer.size();
+}
+
+RuntimeInput::RuntimeInput(const vector<int64_t> &values) : values(&values) {}
+
+// Skips whitespace and makes sure the word that follows is wholly in the buffer
+bool RuntimeInput::ensureToken() {
+    while (true) {
+        while (pos < end && isSpace(*pos)) pos++;
+        if (pos < end) {
+            const char *wordEnd = find_if(pos, end, isSpace);
+            if (wordEnd < end || !stream) return true;
+        }
+        if (!refill()) return pos < end;
+    }
+}
+
+// Keeps the unread tail and appends what the stream has ready, at least one character
+bool RuntimeInput::refill() {
+    if (!stream) return false;
+    buffer.erase(0, static_cast<size_t>(pos - buffer.data()));
+    size_t kept = buffer.size();
+
+    streambuf *source = stream->rdbuf();
+    if (tied && source->in_avail() <= 0) tied->flush();
+    streamsize ready = source->in_avail();
+    size_t want = min(inputBlock, static_cast<size_t>(max<streamsize>(ready, 1)));
+    buffer.resize(kept + want);
+    streamsize got = source->sgetn(&buffer[kept], static_cast<streamsize>(want));
+    buffer.resize(kept + static_cast<size_t>(max<streamsize>(got, 0)));
+    pos = buffer.data();
+    end = pos + buffer.size();
+    if (got <= 0) {
+        stream->setstate(ios::eofbit);
+        stream = nullptr;
+        return false;
+    }
+    return true;
+}
+
+RuntimeOutput::RuntimeOutput(ostream &out) : stream(&out) {}
+
+RuntimeOutput::RuntimeOutput(vector<int64_t> &values) : values(&values) {}
+
+RuntimeOutput::~RuntimeOutput() {
+    flush();
+}
+
+void RuntimeOutput::flush() {
+    if (!stream || used == 0) return;
+    stream->write(block, static_cast<streamsize>(used));
+    stream->flush();
+    used = 0;
+}
@@ -0,0 +1,87 @@
+#ifndef RUNTIMEIO_H
+#define RUNTIMEIO_H
+
+#include <charconv>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class RuntimeOutput;
+
+// Integers for read statements. Text is parsed with from_chars out of a large
+// buffer; the same whitespace separated values as `in >> value` are accepted.
+// A stream is read ahead, so it should not be shared with other readers.
+class RuntimeInput {
+public:
+    explicit RuntimeInput(istream &in);
+    explicit RuntimeInput(string text);
+    explicit RuntimeInput(const vector<int64_t> &values);
+
+    // Output to flush before waiting on the stream, so prompts and partial results show up
+    void tie(RuntimeOutput *output) { tied = output; }
+
+    // False at the end of the input or when the next word is not an integer
+    bool next(int64_t &value) {
+        if (values) {
+            if (valueIndex == values->size()) return false;
+            value = (*values)[valueIndex++];
+            return true;
+        }
+        if (!ensureToken()) return false;
+        if (*pos == '+' && pos + 1 < end && *(pos + 1) != '-') pos++;
+        from_chars_result result = from_chars(pos, end, value);
+        if (result.ec != errc()) return false;
+        pos = result.ptr;
+        return true;
+    }
+
+private:
+    istream *stream = nullptr;
+    string buffer;
+    const char *pos = nullptr;
+    const char *end = nullptr;
+    const vector<int64_t> *values = nullptr;
+    size_t valueIndex = 0;
+    RuntimeOutput *tied = nullptr;
+
+    bool ensureToken();
+    bool refill();
+};
+
+// Values printed by write statements, one per line. Stream output is formatted
+// with to_chars into a block that is written out when full, on flush() and on
+// destruction.
+class RuntimeOutput {
+public:
+    explicit RuntimeOutput(ostream &out);
+    explicit RuntimeOutput(vector<int64_t> &values);
+    ~RuntimeOutput();
+
+    RuntimeOutput(const RuntimeOutput &) = delete;
+    RuntimeOutput &operator=(const RuntimeOutput &) = delete;
+
+    void write(int64_t value) {
+        if (values) {
+            values->push_back(value);
+            return;
+        }
+        if (used + 21 > sizeof(block)) flush();
+        char *last = to_chars(block + used, block + sizeof(block), value).ptr;
+        *last = '\n';
+        used = static_cast<size_t>(last + 1 - block);
+    }
+
+    void flush();
+
+private:
+    ostream *stream = nullptr;
+    vector<int64_t> *values = nullptr;
+    char block[1 << 16];
+    size_t used = 0;
+};
+
+#endif // RUNTIMEIO_H
@@ -1,6 +1,5 @@
 #include "Scanner.h"
 #include <unordered_map>
-#include <stdexcept>
 #include <cctype>
 
 using namespace std;
@@ -32,13 +31,38 @@ bool isIdentifier(const string &str) {
     return !str.empty();
 }
 
+// Appends the token for a finished word; false if the word is not part of the language
+bool addWord(const string &word, int lineCount, int column, vector<Token> &tokens) {
+    auto keyword = tokenMap.find(word);
+    if (keyword != tokenMap.end()) {
+        tokens.push_back({word, keyword->second, lineCount, column});
+    } else if (isNumber(word)) {
+        tokens.push_back({word, "NUMBER", lineCount, column});
+    } else if (isIdentifier(word)) {
+        tokens.push_back({word, "IDENTIFIER", lineCount, column});
+    } else {
+        return false;
+    }
+    return true;
+}
+
 // Tokenizer implementation
 vector<Token> tokenize(const string &line, int lineCount) {
+    return tokenize(line, lineCount, inComment);
+}
+
+vector<Token> tokenize(const string &line, int lineCount, bool &inComment) {
+    return tryTokenize(line, lineCount, inComment).valueOrRaise();
+}
+
+Expected<vector<Token>> tryTokenize(const string &line, int lineCount, bool &inComment) {
     vector<Token> tokens;
     string currentWord;
+    int wordStart = 0;
 
     for (size_t i = 0; i < line.size(); ++i) {
         char c = line[i];
+        int column = static_cast<int>(i);
 
         // Handle comment start
         if (c == '{') {
@@ -60,15 +84,8 @@ vector<Token> tokenize(const string &line, int lineCount) {
         // Check for whitespace to finalize a token
         if (isspace(c)) {
             if (!currentWord.empty()) {
-                if (tokenMap.count(currentWord) > 0) {
-                    tokens.push_back({currentWord, tokenMap[currentWord], lineCount});
-                } else if (isNumber(currentWord)) {
-                    tokens.push_back({currentWord, "NUMBER", lineCount});
-                } else if (isIdentifier(currentWord)) {
-                    tokens.push_back({currentWord, "IDENTIFIER", lineCount});
-                } else {
-                    throw runtime_error(
-                        "Error at line " + to_string(lineCount) + "  :  Unknown token \"" + currentWord + "\"");
+                if (!addWord(currentWord, lineCount, wordStart, tokens)) {
+                    return Diagnostic{DiagnosticCode::UnknownWord, lineCount, wordStart, currentWord, ""};
                 }
                 currentWord.clear();
             }
@@ -78,51 +95,36 @@ vector<Token> tokenize(const string &line, int lineCount) {
         // Handle symbols and operators
         if (ispunct(c)) {
             if (!currentWord.empty()) {
-                if (tokenMap.count(currentWord) > 0) {
-                    tokens.push_back({currentWord, tokenMap[currentWord], lineCount});
-                } else if (isNumber(currentWord)) {
-                    tokens.push_back({currentWord, "NUMBER", lineCount});
-                } else if (isIdentifier(currentWord)) {
-                    tokens.push_back({currentWord, "IDENTIFIER", lineCount});
-                } else {
-                    throw runtime_error(
-                        "Error at line " + to_string(lineCount) + "  :  Unknown token \"" + currentWord + "\"");
+                if (!addWord(currentWord, lineCount, wordStart, tokens)) {
+                    return Diagnostic{DiagnosticCode::UnknownWord, lineCount, wordStart, currentWord, ""};
                 }
                 currentWord.clear();
             }
 
             if (c == '<') {
-                tokens.push_back({string(1, c), "LESSTHAN", lineCount});
+                tokens.push_back({string(1, c), "LESSTHAN", lineCount, column});
             } else if (c == ':' && i + 1 < line.size() && line[i + 1] == '=') {
-                tokens.push_back({string(1, c) + line[i + 1], "ASSIGN", lineCount});
+                tokens.push_back({string(1, c) + line[i + 1], "ASSIGN", lineCount, column});
                 ++i; // Skip the next character
             } else {
                 string symbol(1, c);
-                if (tokenMap.count(symbol) > 0) {
-                    tokens.push_back({symbol, tokenMap[symbol], lineCount});
-                } else {
-                    throw runtime_error(
-                        "Error at line " + to_string(lineCount) + " : Unknown token \"" + string(1, c) + "\"");
+                auto known = tokenMap.find(symbol);
+                if (known == tokenMap.end()) {
+                    return Diagnostic{DiagnosticCode::UnknownSymbol, lineCount, column, symbol, ""};
                 }
+                tokens.push_back({symbol, known->second, lineCount, column});
             }
             continue;
         }
 
         // If part of a word, add to currentWord
+        if (currentWord.empty()) wordStart = column;
         currentWord += c;
     }
 
     // Process the last word if there is one
-    if (!currentWord.empty()) {
-        if (tokenMap.count(currentWord) > 0) {
-            tokens.push_back({currentWord, tokenMap[currentWord], lineCount});
-        } else if (isNumber(currentWord)) {
-            tokens.push_back({currentWord, "NUMBER", lineCount});
-        } else if (isIdentifier(currentWord)) {
-            tokens.push_back({currentWord, "IDENTIFIER", lineCount});
-        } else {
-            throw runtime_error("Error at line " + to_string(lineCount) + "  :  Unknown token \"" + currentWord + "\"");
-        }
+    if (!currentWord.empty() && !addWord(currentWord, lineCount, wordStart, tokens)) {
+        return Diagnostic{DiagnosticCode::UnknownWord, lineCount, wordStart, currentWord, ""};
     }
 
     return tokens;
@@ -3,10 +3,22 @@
 
 #include <string>
 #include <vector>
+#include "Diagnostic.h"
 #include "Token.h"
 
 using namespace std;
 
+// Comment state carried between tokenize() calls
+extern bool inComment;
+
 vector<Token> tokenize(const string& line, int lineCount);
 
+// Same as above with an explicit comment state, so independent buffers can be
+// scanned concurrently
+vector<Token> tokenize(const string& line, int lineCount, bool& commentState);
+
+// Same without exceptions: an unknown token comes back as a Diagnostic. The throwing
+// forms above raise exactly that diagnostic.
+Expected<vector<Token>> tryTokenize(const string& line, int lineCount, bool& commentState);
+
 #endif // SCANNER_H
@@ -0,0 +1,172 @@
+#include "SemanticAnalyzer.h"
+#include "TreeVisitor.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+
+enum class ValueType { None, Integer, Boolean };
+
+// Variables that are assigned on every path to the current point, as one bit per
+// variable. Every bit set goes on a trail, so a branch can be rolled back in time
+// proportional to what it defined instead of copying the whole vector.
+class DefinedSet {
+public:
+    bool test(int variable) const {
+        size_t word = static_cast<size_t>(variable) / 64;
+        return word < bits.size() && (bits[word] >> (variable % 64) & 1);
+    }
+
+    void define(int variable) {
+        if (test(variable)) return;
+        size_t word = static_cast<size_t>(variable) / 64;
+        if (word >= bits.size()) bits.resize(word + 1, 0);
+        bits[word] |= uint64_t(1) << (variable % 64);
+        trail.push_back(variable);
+    }
+
+    size_t mark() const { return trail.size(); }
+
+    // Clears everything defined since `mark` and returns it
+    vector<int> undo(size_t mark) {
+        vector<int> undone(trail.begin() + static_cast<ptrdiff_t>(mark), trail.end());
+        for (int variable: undone) {
+            bits[static_cast<size_t>(variable) / 64] &= ~(uint64_t(1) << (variable % 64));
+        }
+        trail.resize(mark);
+        return undone;
+    }
+
+private:
+    vector<uint64_t> bits;
+    vector<int> trail;
+};
+
+// Type checking and definite assignment in one pass over the structured program.
+// Without goto, the state after an if is the intersection of its branches and a
+// repeat body is first entered with the state before the loop, which is exactly
+// what an iterative bit-vector dataflow over the statement graph converges to.
+class SemanticChecker : public TreeVisitor<SemanticChecker, ValueType> {
+public:
+    vector<SemanticIssue> issues;
+
+    ValueType visitSeq(const TreeNode &node) {
+        for (const auto &statement: node.children) {
+            if (statement) visit(*statement);
+        }
+        return ValueType::None;
+    }
+
+    ValueType visitIf(const TreeNode &node) {
+        expectCondition(node, "if");
+        size_t before = defined.mark();
+        visitChild(node, 1);
+        vector<int> thenDefined = defined.undo(before);
+        if (node.children.size() > 2) {
+            visitChild(node, 2);
+            vector<int> elseDefined = defined.undo(before);
+            stamp++;
+            for (int variable: thenDefined) stamps[variable] = stamp;
+            for (int variable: elseDefined) {
+                if (stamps[variable] == stamp) defined.define(variable);
+            }
+        }
+        return ValueType::None;
+    }
+
+    ValueType visitRepeat(const TreeNode &node) {
+        visitChild(node, 0);
+        expectCondition(node, "repeat");
+        return ValueType::None;
+    }
+
+    ValueType visitAssign(const TreeNode &node) {
+        expressionLine = node.line;
+        if (visitChild(node, 0) == ValueType::Boolean) {
+            report(true, node.line, "Assignment of a boolean value to \"" + node.value + "\"");
+        }
+        defined.define(variable(node.value));
+        return ValueType::None;
+    }
+
+    ValueType visitRead(const TreeNode &node) {
+        defined.define(variable(node.value));
+        return ValueType::None;
+    }
+
+    ValueType visitWrite(const TreeNode &node) {
+        expressionLine = node.line;
+        if (visitChild(node, 0) == ValueType::Boolean) {
+            report(true, node.line, "Write of a boolean value");
+        }
+        return ValueType::None;
+    }
+
+    ValueType visitOp(const TreeNode &node) {
+        ValueType left = visitChild(node, 0);
+        ValueType right = visitChild(node, 1);
+        if (left == ValueType::Boolean || right == ValueType::Boolean) {
+            report(true, expressionLine, string("Operator \"") + opSymbol(node.op) + "\" applied to a boolean value");
+        }
+        return node.op == OpKind::Less || node.op == OpKind::Equal ? ValueType::Boolean : ValueType::Integer;
+    }
+
+    ValueType visitConst(const TreeNode &) {
+        return ValueType::Integer;
+    }
+
+    ValueType visitId(const TreeNode &node) {
+        int index = variable(node.value);
+        if (!defined.test(index) && !warned[index]) {
+            warned[index] = true;
+            report(false, expressionLine, "Variable \"" + node.value + "\" may be used before it is assigned");
+        }
+        return ValueType::Integer;
+    }
+
+private:
+    DefinedSet defined;
+    unordered_map<string, int> variables;
+    vector<bool> warned;
+    int expressionLine = 0; // statement line for issues inside expressions, which may be shared
+    vector<unsigned> stamps; // intersects branch definitions without clearing
+    unsigned stamp = 0;
+
+    int variable(const string &name) {
+        auto it = variables.emplace(name, static_cast<int>(variables.size())).first;
+        if (it->second == static_cast<int>(warned.size())) {
+            warned.push_back(false);
+            stamps.push_back(0);
+        }
+        return it->second;
+    }
+
+    ValueType visitChild(const TreeNode &node, size_t index) {
+        if (index >= node.children.size() || !node.children[index]) return ValueType::None;
+        return visit(*node.children[index]);
+    }
+
+    // The test is the first child of an if and the last of a repeat
+    void expectCondition(const TreeNode &node, const char *statement) {
+        size_t index = node.kind == NodeKind::If ? 0 : node.children.size() - 1;
+        expressionLine = node.kind == NodeKind::If ? node.line : node.untilLine;
+        if (visitChild(node, index) == ValueType::Integer) {
+            report(true, expressionLine, string("Condition of \"") + statement + "\" is an integer, not a comparison");
+        }
+    }
+
+    void report(bool error, int line, const string &text) {
+        issues.push_back({error, line, string(error ? "Error" : "Warning") + " at line " + to_string(line) + " : " + text});
+    }
+};
+
+} // namespace
+
+vector<SemanticIssue> checkSemantics(const TreeNode &root) {
+    SemanticChecker checker;
+    checker.visit(root);
+    return move(checker.issues);
+}
@@ -0,0 +1,25 @@
+#ifndef SEMANTICANALYZER_H
+#define SEMANTICANALYZER_H
+
+#include <string>
+#include <vector>
+#include "TreeNode.h"
+
+using namespace std;
+
+struct SemanticIssue {
+    bool error;     // false for warnings
+    int line;
+    string message; // "Error at line N : ..." or "Warning at line N : ..."
+};
+
+// Checks a parsed program without running it:
+//  - conditions of if/until must be comparisons, and operands, assigned and
+//    written values must be integers (errors);
+//  - a variable read on some path before any assignment or read statement
+//    defined it is reported once (warning).
+// Issues come in source order. Runs in time linear in the tree size times the
+// nesting depth of if statements, whatever the number of variables.
+vector<SemanticIssue> checkSemantics(const TreeNode &root);
+
+#endif // SEMANTICANALYZER_H
@@ -0,0 +1,59 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Lock-free bounded ring for exactly one producer thread and one consumer thread.
+// push() waits while the ring is full, which throttles a producer that runs ahead.
+template<typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    void push(T value) {
+        size_t tail = this->tail.load(memory_order_relaxed);
+        while (tail - head.load(memory_order_acquire) > mask) {
+            this_thread::yield();
+        }
+        slots[tail & mask] = move(value);
+        this->tail.store(tail + 1, memory_order_release);
+    }
+
+    // Waits for the next value; returns false once the ring is closed and drained
+    bool pop(T &value) {
+        size_t head = this->head.load(memory_order_relaxed);
+        while (head == tail.load(memory_order_acquire)) {
+            if (closed.load(memory_order_acquire) && head == tail.load(memory_order_acquire)) return false;
+            this_thread::yield();
+        }
+        value = move(slots[head & mask]);
+        this->head.store(head + 1, memory_order_release);
+        return true;
+    }
+
+    // Called by the producer after its last push
+    void close() {
+        closed.store(true, memory_order_release);
+    }
+
+private:
+    vector<T> slots;
+    size_t mask = 0;
+    alignas(64) atomic<size_t> head{0}; // next slot to read, owned by the consumer
+    alignas(64) atomic<size_t> tail{0}; // next slot to write, owned by the producer
+    atomic<bool> closed{false};
+};
+
+#endif // SPSCRING_H
@@ -0,0 +1,184 @@
+#include "StreamRunner.h"
+#include "CodeGenerator.h"
+#include "LoopOptimizer.h"
+#include "Parser.h"
+#include "RangeAnalysis.h"
+#include "Scanner.h"
+#include "SemanticAnalyzer.h"
+#include "TreeVisitor.h"
+#include "VirtualMachine.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Complete statements are run once this many tokens are waiting, even with more input ready
+const size_t chunkTokens = 4096;
+
+shared_ptr<TreeNode> leaf(NodeKind kind, string value, int line) {
+    auto node = make_shared<TreeNode>(kind, move(value));
+    node->line = line;
+    return node;
+}
+
+shared_ptr<TreeNode> binary(OpKind op, shared_ptr<TreeNode> left, shared_ptr<TreeNode> right) {
+    auto node = make_shared<TreeNode>(op);
+    node->line = left->line;
+    node->children.push_back(move(left));
+    node->children.push_back(move(right));
+    return node;
+}
+
+// An expression for `value`; a negative one is 0 - (-value - 1) - 1, which holds
+// INT64_MIN without overflowing under --checked and folds back to one constant
+shared_ptr<TreeNode> literal(int64_t value, int line) {
+    if (value >= 0) return leaf(NodeKind::Const, to_string(value), line);
+    auto magnitude = leaf(NodeKind::Const, to_string(-(value + 1)), line);
+    auto negated = binary(OpKind::Minus, leaf(NodeKind::Const, "0", line), move(magnitude));
+    return binary(OpKind::Minus, move(negated), leaf(NodeKind::Const, "1", line));
+}
+
+// Variables a chunk uses, in order of first appearance
+class VariableNames : public TreeVisitor<VariableNames> {
+public:
+    vector<string> names;
+
+    void visitAssign(const TreeNode &node) {
+        visitChildren(node);
+        add(node.value);
+    }
+    void visitRead(const TreeNode &node) { add(node.value); }
+    void visitId(const TreeNode &node) { add(node.value); }
+
+private:
+    unordered_set<string> seen;
+
+    void add(const string &name) {
+        if (seen.insert(name).second) names.push_back(name);
+    }
+};
+
+class StreamRunner {
+public:
+    StreamRunner(RuntimeInput &in, RuntimeOutput &out, const StreamOptions &options)
+        : in(in), out(out), options(options) {}
+
+    StreamStats run(istream &source) {
+        vector<Token> pending; // after the first chunk, starts with the SEMICOLON that ended the last one
+        size_t start = 0;      // first token of `pending` to parse
+        size_t complete = 0;   // pending[start, complete) are whole statements with their SEMICOLONs
+        int depth = 0;         // if/repeat blocks open at the end of `pending`
+        bool commentState = false;
+        int lineCount = 1;
+        string line;
+        streambuf *buffer = source.rdbuf();
+
+        while (true) {
+            if (buffer->in_avail() <= 0) out.flush();
+            if (!getline(source, line)) break;
+            vector<Token> tokens = tryTokenize(line, lineCount++, commentState).valueOrRaise();
+            for (Token &token: tokens) {
+                const string &type = token.type;
+                if (type == "IF" || type == "REPEAT") {
+                    depth++;
+                } else if (type == "END" || type == "UNTIL") {
+                    depth--;
+                }
+                bool split = type == "SEMICOLON" && depth == 0;
+                pending.push_back(move(token));
+                if (depth < 0) {
+                    // An END or UNTIL without its block: the parse stops before it
+                    runChunk(move(pending), start, false);
+                    return stats;
+                }
+                if (split) complete = pending.size();
+            }
+            stats.maxPending = max(stats.maxPending, pending.size());
+
+            if (complete > start && (pending.size() >= chunkTokens || buffer->in_avail() <= 0)) {
+                // The next chunk keeps the SEMICOLON, so its errors see the same previous token
+                vector<Token> chunk(make_move_iterator(pending.begin()),
+                                    make_move_iterator(pending.begin() + static_cast<ptrdiff_t>(complete)));
+                pending.erase(pending.begin(), pending.begin() + static_cast<ptrdiff_t>(complete) - 1);
+                pending.front() = chunk.back();
+                if (!runChunk(move(chunk), start, true)) return stats;
+                start = 1;
+                complete = 0;
+            }
+        }
+
+        if (pending.size() > start) {
+            runChunk(move(pending), start, false);
+        } else if (start == 1) {
+            runChunk(move(pending), 0, false); // fails on the SEMICOLON at the end, as parse() does
+        } else {
+            raiseDiagnostic(Diagnostic{DiagnosticCode::NoTokens, 0, 0, "", ""});
+        }
+        return stats;
+    }
+
+private:
+    RuntimeInput &in;
+    RuntimeOutput &out;
+    const StreamOptions &options;
+    unordered_map<string, int64_t> values; // of every variable after the last chunk
+    StreamStats stats;
+
+    // Parses and runs the statements from tokens[start]; false when the parse of the
+    // whole program would stop among them, so that nothing after them counts
+    bool runChunk(vector<Token> tokens, size_t start, bool bounded) {
+        Parser parser(move(tokens));
+        shared_ptr<TreeNode> sequence = parser.parseChunk(start, bounded);
+        for (const SemanticIssue &issue: checkSemantics(*sequence)) {
+            if (issue.error) throw runtime_error(issue.message);
+        }
+        execute(*sequence);
+        return !bounded || parser.atLastToken();
+    }
+
+    void execute(TreeNode &sequence) {
+        stats.chunks++;
+        stats.statements += sequence.children.size();
+
+        // Values from earlier chunks become assignments in front, so the chunk compiles
+        // to a program of its own whose variables start at 0
+        VariableNames used;
+        used.visit(sequence);
+        vector<shared_ptr<TreeNode>> prologue;
+        for (const string &name: used.names) {
+            auto known = values.find(name);
+            if (known == values.end() || known->second == 0) continue;
+            auto assign = make_shared<TreeNode>(NodeKind::Assign, name);
+            assign->line = sequence.line;
+            assign->children.push_back(literal(known->second, sequence.line));
+            prologue.push_back(move(assign));
+        }
+        sequence.children.insert(sequence.children.begin(), make_move_iterator(prologue.begin()),
+                                 make_move_iterator(prologue.end()));
+
+        Program program = compileProgram(sequence, options.overflowChecks);
+        if (options.rangeAnalysis) removeRedundantChecks(program);
+        if (options.loopOptimizations) optimizeLoops(program);
+        VirtualMachine machine(program);
+        machine.run(in, out);
+
+        vector<int64_t> finals = machine.variables();
+        for (size_t v = 0; v < finals.size(); ++v) values[program.variables[v]] = finals[v];
+        stats.variables = values.size();
+    }
+};
+
+} // namespace
+
+StreamStats runStreaming(istream &source, RuntimeInput &in, RuntimeOutput &out, const StreamOptions &options) {
+    StreamRunner runner(in, out, options);
+    return runner.run(source);
+}
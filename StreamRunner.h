@@ -0,0 +1,38 @@
+#ifndef STREAMRUNNER_H
+#define STREAMRUNNER_H
+
+#include <cstddef>
+#include <istream>
+#include "RuntimeIO.h"
+
+using namespace std;
+
+struct StreamOptions {
+    bool loopOptimizations = true;
+    bool overflowChecks = false;
+    bool rangeAnalysis = true;
+};
+
+struct StreamStats {
+    size_t statements = 0;    // top-level statements run
+    size_t chunks = 0;        // separately compiled runs of statements
+    size_t maxPending = 0;    // most tokens held at once
+    size_t variables = 0;     // values carried from chunk to chunk
+};
+
+// Runs a program while it is still arriving on `source`. Lines are scanned as
+// they come in and split after each SEMICOLON outside if/repeat blocks; the
+// complete statements are parsed, checked, compiled and run at once, then
+// dropped, with the variables carried over to the next ones. Statements are
+// grouped while more input is already buffered, up to a few thousand tokens.
+// Output is flushed before waiting for more source, so memory is bounded by
+// the largest top-level statement and the number of variables.
+//
+// Throws runtime_error with the usual message for scan, parse and type errors,
+// and RuntimeError from the VirtualMachine; the statements before the failing
+// one have already run. Tokens after the point where the parse of the whole
+// program would stop are not read. Use-before-assignment warnings need the
+// whole program and are not reported.
+StreamStats runStreaming(istream &source, RuntimeInput &in, RuntimeOutput &out, const StreamOptions &options);
+
+#endif // STREAMRUNNER_H
@@ -0,0 +1,456 @@
+#include "SyntaxTreeItem.h"
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QGraphicsSceneMouseEvent>
+#include <QEasingCurve>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace
+{
+// Below these zoom levels nodes lose their text, then merge into clusters
+const qreal textLod = 0.35;
+const qreal clusterLod = 0.05;
+
+const int animationMs = 250;
+const quint64 rootKey = 0x9e3779b97f4a7c15ULL;
+
+quint64 combine(quint64 seed, quint64 value)
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Statements of a sequence hang directly under the sequence's parent, as in the layout
+void flattenChildren(const TreeNode &node, std::vector<const TreeNode *> &children)
+{
+    for (const auto &child : node.children)
+    {
+        if (!child)
+            continue;
+        if (child->kind == NodeKind::Seq)
+            flattenChildren(*child, children);
+        else
+            children.push_back(child.get());
+    }
+}
+}
+
+SyntaxTreeItem::SyntaxTreeItem(int nodeWidth, int nodeHeight, int xGap, int yOffset)
+    : layout(nodeWidth, xGap, yOffset), nodeWidth(nodeWidth), nodeHeight(nodeHeight), levelHeight(yOffset)
+{
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+    font = QFont("Arial", 12);
+    edgePen = QPen(Qt::red);
+
+    animation.setStartValue(0.0);
+    animation.setEndValue(1.0);
+    animation.setDuration(animationMs);
+    animation.setEasingCurve(QEasingCurve::OutCubic);
+    QObject::connect(&animation, &QVariantAnimation::valueChanged, [this](const QVariant &value) {
+        progress = value.toReal();
+        update();
+    });
+    QObject::connect(&animation, &QVariantAnimation::finished, [this]() { finishAnimation(); });
+}
+
+void SyntaxTreeItem::setTree(std::shared_ptr<TreeNode> root)
+{
+    animation.stop();
+    finishAnimation();
+    std::vector<TreeLayout::Item> previous = layout.items();
+    std::unordered_map<const TreeNode *, quint64> previousKeys = std::move(keys);
+    QRectF previousBounds = bounds;
+
+    keys.clear();
+    if (root)
+        assignKeys(*root, rootKey);
+
+    // Collapsed nodes that survive the edit stay collapsed
+    std::unordered_set<const TreeNode *> stillCollapsed;
+    if (!collapsed.empty())
+    {
+        std::unordered_map<quint64, const TreeNode *> byKey;
+        for (const auto &entry : keys)
+            byKey.emplace(entry.second, entry.first);
+        for (const TreeNode *node : collapsed)
+        {
+            auto found = byKey.find(previousKeys.at(node));
+            if (found != byKey.end())
+                stillCollapsed.insert(found->second);
+        }
+    }
+    collapsed = std::move(stillCollapsed);
+
+    previousRoot = std::move(this->root);
+    this->root = std::move(root);
+    relayout();
+    animateFrom(previous, previousKeys, previousBounds);
+}
+
+void SyntaxTreeItem::toggleCollapsed(const TreeNode *node)
+{
+    animation.stop();
+    finishAnimation();
+    std::vector<TreeLayout::Item> previous = layout.items();
+    QRectF previousBounds = bounds;
+    if (!collapsed.erase(node))
+        collapsed.insert(node);
+    relayout();
+    animateFrom(previous, keys, previousBounds);
+}
+
+// A node's key combines its parent's key, its kind and label, and how many earlier
+// siblings have the same kind and label. Editing a statement therefore only changes
+// the keys of that statement's subtree and of later identical siblings.
+void SyntaxTreeItem::assignKeys(const TreeNode &node, quint64 key)
+{
+    keys[&node] = key;
+    std::vector<const TreeNode *> children;
+    flattenChildren(node, children);
+    std::unordered_map<quint64, quint64> seen;
+    for (const TreeNode *child : children)
+    {
+        quint64 content = combine(static_cast<quint64>(child->kind), std::hash<std::string>()(child->label()));
+        quint64 ordinal = seen[content]++;
+        assignKeys(*child, combine(combine(key, content), ordinal));
+    }
+}
+
+void SyntaxTreeItem::animateFrom(const std::vector<TreeLayout::Item> &previous,
+                                 const std::unordered_map<const TreeNode *, quint64> &previousKeys,
+                                 const QRectF &previousBounds)
+{
+    const std::vector<TreeLayout::Item> &items = layout.items();
+    if (previous.empty() || items.empty())
+    {
+        previousRoot.reset();
+        return;
+    }
+
+    std::unordered_map<quint64, QPointF> before;
+    before.reserve(previous.size());
+    for (const TreeLayout::Item &item : previous)
+        before.emplace(previousKeys.at(item.node), QPointF(item.x, item.y));
+
+    bool changed = false;
+    std::unordered_set<quint64> present;
+    present.reserve(items.size());
+    start.resize(items.size());
+    entering.assign(items.size(), false);
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        quint64 key = keys.at(items[i].node);
+        present.insert(key);
+        QPointF target(items[i].x, items[i].y);
+        auto found = before.find(key);
+        start[i] = found != before.end() ? found->second : target;
+        entering[i] = found == before.end();
+        changed = changed || entering[i] || start[i] != target;
+    }
+    for (const TreeLayout::Item &item : previous)
+    {
+        if (!present.count(previousKeys.at(item.node)))
+            leaving.push_back(item);
+    }
+
+    if (!changed && leaving.empty())
+    {
+        finishAnimation();
+        return;
+    }
+    // Leaving nodes are drawn where they were, so the item covers both layouts meanwhile
+    setBounds(bounds.united(previousBounds));
+    progress = 0;
+    animation.start();
+}
+
+void SyntaxTreeItem::finishAnimation()
+{
+    progress = 1;
+    start.clear();
+    entering.clear();
+    leaving.clear();
+    previousRoot.reset();
+    setBounds(QRectF(0, 0, layout.width(), layout.height() + nodeHeight));
+    update();
+}
+
+void SyntaxTreeItem::relayout()
+{
+    prepareGeometryChange();
+    layout.compute(root, margin, &collapsed);
+    const std::vector<TreeLayout::Item> &items = layout.items();
+
+    int depthCount = 0;
+    for (const TreeLayout::Item &item : items)
+        depthCount = std::max(depthCount, item.depth + 1);
+    levels.assign(depthCount, {});
+    edges.assign(depthCount, {});
+    widestEdge.assign(depthCount, 0);
+
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        const TreeLayout::Item &item = items[i];
+        levels[item.depth].push_back(static_cast<int>(i));
+        if (item.from < 0)
+            continue;
+
+        const TreeLayout::Item &from = items[item.from];
+        qreal left = item.siblingEdge ? from.x + nodeWidth : std::min(from.x, item.x) + nodeWidth / 2.0;
+        qreal right = item.siblingEdge ? item.x : std::max(from.x, item.x) + nodeWidth / 2.0;
+        edges[item.depth].push_back({left, right, item.from, static_cast<int>(i)});
+        widestEdge[item.depth] = std::max(widestEdge[item.depth], right - left);
+    }
+
+    for (int level = 0; level < depthCount; ++level)
+    {
+        std::sort(levels[level].begin(), levels[level].end(),
+                  [&](int a, int b) { return items[a].x < items[b].x; });
+        std::sort(edges[level].begin(), edges[level].end(),
+                  [](const Edge &a, const Edge &b) { return a.left < b.left; });
+    }
+
+    setBounds(QRectF(0, 0, layout.width(), layout.height() + nodeHeight));
+    update();
+}
+
+void SyntaxTreeItem::setBounds(const QRectF &rect)
+{
+    if (rect == bounds)
+        return;
+    prepareGeometryChange();
+    bounds = rect;
+    if (boundsChanged)
+        boundsChanged(bounds);
+}
+
+void SyntaxTreeItem::setBoundsChanged(std::function<void(const QRectF &)> handler)
+{
+    boundsChanged = std::move(handler);
+}
+
+QRectF SyntaxTreeItem::boundingRect() const
+{
+    return bounds;
+}
+
+void SyntaxTreeItem::levelRange(const QRectF &rect, int &first, int &last) const
+{
+    first = std::max(0, static_cast<int>(std::floor((rect.top() - margin - nodeHeight) / levelHeight)));
+    last = std::min(static_cast<int>(levels.size()) - 1,
+                    static_cast<int>(std::floor((rect.bottom() - margin) / levelHeight)));
+}
+
+// First node on the level whose right edge is at or after `left`
+std::vector<int>::const_iterator SyntaxTreeItem::firstVisible(int level, qreal left) const
+{
+    const std::vector<TreeLayout::Item> &items = layout.items();
+    return std::lower_bound(levels[level].begin(), levels[level].end(), left,
+                            [&](int index, qreal x) { return items[index].x + nodeWidth < x; });
+}
+
+int SyntaxTreeItem::itemAt(const QPointF &pos) const
+{
+    int level = static_cast<int>(std::floor((pos.y() - margin) / levelHeight));
+    if (level < 0 || level >= static_cast<int>(levels.size()) ||
+        pos.y() > margin + level * levelHeight + nodeHeight)
+        return -1;
+
+    auto it = firstVisible(level, pos.x());
+    if (it == levels[level].end() || layout.items()[*it].x > pos.x())
+        return -1;
+    return *it;
+}
+
+void SyntaxTreeItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    Q_UNUSED(widget);
+    const qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    const QRectF rect = option->exposedRect;
+
+    int firstLevel = 0;
+    int lastLevel = 0;
+    levelRange(rect, firstLevel, lastLevel);
+    if (levels.empty())
+        return;
+
+    if (lod < clusterLod)
+    {
+        paintClusters(painter, rect, firstLevel, lastLevel, lod);
+        return;
+    }
+    if (progress < 1)
+    {
+        paintAnimated(painter, rect, lod >= textLod);
+        return;
+    }
+    // Edges into the level below the last visible one still cross the exposed area
+    paintEdges(painter, rect, firstLevel, std::min(lastLevel + 1, static_cast<int>(levels.size()) - 1));
+    paintNodes(painter, rect, firstLevel, lastLevel, lod >= textLod);
+}
+
+void SyntaxTreeItem::paintEdges(QPainter *painter, const QRectF &rect, int firstLevel, int lastLevel) const
+{
+    const std::vector<TreeLayout::Item> &items = layout.items();
+    painter->setPen(edgePen);
+    for (int level = firstLevel; level <= lastLevel; ++level)
+    {
+        const std::vector<Edge> &row = edges[level];
+        auto it = std::lower_bound(row.begin(), row.end(), rect.left() - widestEdge[level],
+                                   [](const Edge &edge, qreal x) { return edge.left < x; });
+        for (; it != row.end() && it->left <= rect.right(); ++it)
+        {
+            if (it->right < rect.left())
+                continue;
+            const TreeLayout::Item &from = items[it->from];
+            const TreeLayout::Item &to = items[it->to];
+            if (to.siblingEdge)
+                painter->drawLine(QPointF(from.x + nodeWidth, from.y + nodeHeight / 2.0),
+                                  QPointF(to.x, to.y + nodeHeight / 2.0));
+            else
+                painter->drawLine(QPointF(from.x + nodeWidth / 2.0, from.y + nodeHeight),
+                                  QPointF(to.x + nodeWidth / 2.0, to.y));
+        }
+    }
+}
+
+void SyntaxTreeItem::paintNodes(QPainter *painter, const QRectF &rect, int firstLevel, int lastLevel,
+                                bool withText) const
+{
+    const std::vector<TreeLayout::Item> &items = layout.items();
+    painter->setBrush(Qt::white);
+    painter->setFont(font);
+
+    for (int level = firstLevel; level <= lastLevel; ++level)
+    {
+        for (auto it = firstVisible(level, rect.left()); it != levels[level].end(); ++it)
+        {
+            const TreeLayout::Item &item = items[*it];
+            if (item.x > rect.right())
+                break;
+            paintNode(painter, item, QRectF(item.x, item.y, nodeWidth, nodeHeight), withText);
+        }
+    }
+}
+
+void SyntaxTreeItem::paintNode(QPainter *painter, const TreeLayout::Item &item, const QRectF &box,
+                               bool withText) const
+{
+    const TreeNode *node = item.node;
+    painter->setPen(item.collapsed ? QPen(Qt::black, 4) : QPen(Qt::black));
+    if (isStatement(node->kind))
+        painter->drawRect(box);
+    else
+        painter->drawEllipse(box);
+
+    if (!withText)
+        return;
+    painter->setPen(QPen(Qt::black));
+    QRectF top(box.left(), box.top(), box.width(), box.height() / 2);
+    const std::string label = node->label();
+    painter->drawText(label.empty() ? box : top, Qt::AlignCenter, QString::fromLatin1(kindName(node->kind)));
+    if (!label.empty())
+        painter->drawText(top.translated(0, top.height()), Qt::AlignCenter,
+                          "(" + QString::fromStdString(label) + ")");
+}
+
+// Mid-animation the sorted levels no longer match where nodes are drawn, so every
+// node is placed and culled on its own. This only lasts a few frames.
+void SyntaxTreeItem::paintAnimated(QPainter *painter, const QRectF &rect, bool withText) const
+{
+    const std::vector<TreeLayout::Item> &items = layout.items();
+    std::vector<QPointF> at(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+        at[i] = start[i] + (QPointF(items[i].x, items[i].y) - start[i]) * progress;
+
+    painter->setPen(edgePen);
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (items[i].from < 0)
+            continue;
+        QPointF from = at[items[i].from];
+        QLineF line = items[i].siblingEdge
+                          ? QLineF(from + QPointF(nodeWidth, nodeHeight / 2.0), at[i] + QPointF(0, nodeHeight / 2.0))
+                          : QLineF(from + QPointF(nodeWidth / 2.0, nodeHeight), at[i] + QPointF(nodeWidth / 2.0, 0));
+        if (QRectF(line.p1(), line.p2()).normalized().adjusted(-1, -1, 1, 1).intersects(rect))
+        {
+            painter->setOpacity(entering[i] ? progress : 1);
+            painter->drawLine(line);
+        }
+    }
+
+    painter->setBrush(Qt::white);
+    painter->setFont(font);
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        QRectF box(at[i], QSizeF(nodeWidth, nodeHeight));
+        if (!box.intersects(rect))
+            continue;
+        painter->setOpacity(entering[i] ? progress : 1);
+        paintNode(painter, items[i], box, withText);
+    }
+    for (const TreeLayout::Item &item : leaving)
+    {
+        QRectF box(item.x, item.y, nodeWidth, nodeHeight);
+        if (!box.intersects(rect))
+            continue;
+        painter->setOpacity(1 - progress);
+        paintNode(painter, item, box, withText);
+    }
+    painter->setOpacity(1);
+}
+
+// Far out, runs of nodes closer than a few pixels on screen become one bar
+void SyntaxTreeItem::paintClusters(QPainter *painter, const QRectF &rect, int firstLevel, int lastLevel,
+                                   qreal lod) const
+{
+    const std::vector<TreeLayout::Item> &items = layout.items();
+    const qreal gap = 4 / lod;
+    painter->setPen(Qt::NoPen);
+    painter->setBrush(Qt::darkGray);
+
+    for (int level = firstLevel; level <= lastLevel; ++level)
+    {
+        qreal runLeft = 0;
+        qreal runRight = -1;
+        qreal y = margin + level * levelHeight;
+        for (auto it = firstVisible(level, rect.left()); it != levels[level].end(); ++it)
+        {
+            const TreeLayout::Item &item = items[*it];
+            if (item.x > rect.right())
+                break;
+            if (runRight >= runLeft && item.x <= runRight + gap)
+            {
+                runRight = item.x + nodeWidth;
+                continue;
+            }
+            if (runRight >= runLeft)
+                painter->drawRect(QRectF(runLeft, y, runRight - runLeft, nodeHeight));
+            runLeft = item.x;
+            runRight = item.x + nodeWidth;
+        }
+        if (runRight >= runLeft)
+            painter->drawRect(QRectF(runLeft, y, runRight - runLeft, nodeHeight));
+    }
+}
+
+// The scene only sends a double-click to the item that took the press before it
+void SyntaxTreeItem::mousePressEvent(QGraphicsSceneMouseEvent *event)
+{
+    if (itemAt(event->pos()) >= 0)
+        event->accept();
+    else
+        event->ignore();
+}
+
+void SyntaxTreeItem::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event)
+{
+    int index = itemAt(event->pos());
+    if (index >= 0 && !layout.items()[index].node->children.empty())
+    {
+        toggleCollapsed(layout.items()[index].node);
+        return;
+    }
+    QGraphicsItem::mouseDoubleClickEvent(event);
+}
@@ -0,0 +1,91 @@
+#ifndef SYNTAXTREEITEM_H
+#define SYNTAXTREEITEM_H
+
+#include <QGraphicsItem>
+#include <QFont>
+#include <QPen>
+#include <QVariantAnimation>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "TreeNode.h"
+#include "TreeLayout.h"
+
+// A single scene item that paints a whole syntax tree. Only the nodes and edges
+// inside the exposed rectangle are painted; when zoomed out, nodes are drawn as
+// plain glyphs and then as merged clusters. Double-clicking a node collapses or
+// expands its subtree; presses elsewhere are left to the view, so it can still pan.
+//
+// Nodes keep a key across re-parses (see assignKeys), so a new tree is diffed
+// against the previous one: nodes that survive glide from their old place to the
+// new one, new nodes fade in and removed ones fade out, and collapsed subtrees
+// stay collapsed.
+class SyntaxTreeItem : public QGraphicsItem
+{
+public:
+    SyntaxTreeItem(int nodeWidth, int nodeHeight, int xGap, int yOffset);
+
+    void setTree(std::shared_ptr<TreeNode> root);
+    void toggleCollapsed(const TreeNode *node);
+    // Called whenever boundingRect() changes, also while an animation settles
+    void setBoundsChanged(std::function<void(const QRectF &)> handler);
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+protected:
+    void mousePressEvent(QGraphicsSceneMouseEvent *event) override;
+    void mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) override;
+
+private:
+    struct Edge
+    {
+        qreal left;
+        qreal right;
+        int from;
+        int to;
+    };
+
+    void relayout();
+    void setBounds(const QRectF &rect);
+    void assignKeys(const TreeNode &node, quint64 key);
+    void animateFrom(const std::vector<TreeLayout::Item> &previous,
+                     const std::unordered_map<const TreeNode *, quint64> &previousKeys, const QRectF &previousBounds);
+    void finishAnimation();
+    int itemAt(const QPointF &pos) const;
+    void levelRange(const QRectF &rect, int &first, int &last) const;
+    std::vector<int>::const_iterator firstVisible(int level, qreal left) const;
+    void paintEdges(QPainter *painter, const QRectF &rect, int firstLevel, int lastLevel) const;
+    void paintNodes(QPainter *painter, const QRectF &rect, int firstLevel, int lastLevel, bool withText) const;
+    void paintClusters(QPainter *painter, const QRectF &rect, int firstLevel, int lastLevel, qreal lod) const;
+    void paintAnimated(QPainter *painter, const QRectF &rect, bool withText) const;
+    void paintNode(QPainter *painter, const TreeLayout::Item &item, const QRectF &box, bool withText) const;
+
+    std::shared_ptr<TreeNode> root;
+    std::unordered_set<const TreeNode *> collapsed;
+    std::unordered_map<const TreeNode *, quint64> keys;
+    TreeLayout layout;
+    std::vector<std::vector<int>> levels;   // item indices per level, left to right
+    std::vector<std::vector<Edge>> edges;   // edges into each level, sorted by left end
+    std::vector<qreal> widestEdge;          // longest edge per level, bounds the edge search
+    QRectF bounds;
+    std::function<void(const QRectF &)> boundsChanged;
+    int nodeWidth;
+    int nodeHeight;
+    int levelHeight;
+    qreal margin = 50;
+    QFont font;
+    QPen edgePen;
+
+    // While the animation runs, item i moves from start[i] to its place in the layout
+    QVariantAnimation animation;
+    qreal progress = 1;
+    std::vector<QPointF> start;
+    std::vector<bool> entering;               // fades in
+    std::vector<TreeLayout::Item> leaving;    // items of the previous layout that fade out
+    std::shared_ptr<TreeNode> previousRoot;   // keeps the leaving nodes alive
+};
+
+#endif // SYNTAXTREEITEM_H
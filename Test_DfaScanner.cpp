@@ -0,0 +1,139 @@
+// Regression tests for the DfaScanner: every line must give the same tokens,
+// errors and comment state as the token-map Scanner, starting both outside and
+// inside a comment. Exits with 1 when a check fails. Build with
+//   g++ -std=c++17 Test_DfaScanner.cpp DfaScanner.cpp Scanner.cpp Diagnostic.cpp
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "DfaScanner.h"
+#include "Scanner.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string &what) {
+    if (!condition) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+string describe(const Expected<vector<Token>> &result, bool commentState) {
+    string text;
+    if (result) {
+        for (const Token &token: result.value()) {
+            text += token.type + "(" + token.value + ")@" + to_string(token.line) + ":" +
+                    to_string(token.column) + " ";
+        }
+    } else {
+        text = result.error().message() + " ";
+    }
+    return text + (commentState ? "[in comment]" : "[outside]");
+}
+
+// Scans `lines` in turn with both scanners from `commentState`; returns what the DfaScanner gave
+string compare(const vector<string> &lines, bool commentState) {
+    bool mapState = commentState;
+    bool dfaState = commentState;
+    string dfaText;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        int lineCount = static_cast<int>(i) + 1;
+        Expected<vector<Token>> expected = tryTokenize(lines[i], lineCount, mapState);
+        Expected<vector<Token>> actual = tryTokenizeDfa(lines[i], lineCount, dfaState);
+        string expectedText = describe(expected, mapState);
+        dfaText = describe(actual, dfaState);
+        check(expectedText == dfaText, "\"" + lines[i] + "\": " + dfaText + ", expected " + expectedText);
+        if (!expected || !actual) break;
+    }
+    return dfaText;
+}
+
+void compareBoth(const vector<string> &lines) {
+    compare(lines, false);
+    compare(lines, true);
+}
+
+} // namespace
+
+int main() {
+    const vector<string> lines = {
+        "",
+        "read x;",
+        "x := 12 * (y - 3) / z;",
+        "if x < 10 then write x end",
+        "repeat x := x + 1 until x = 10",
+        "x:=y;z:=1",
+        "\tx\t:=\t1",
+        // Keywords are lower case and whole words
+        "If Then END iff ifx endd readx",
+        // Comments inside and around words
+        "x{c}y",
+        "ab{comment}cd := 3",
+        "{}",
+        "{{nested}}",
+        "{ open",
+        "still open } x := 1",
+        "a}b",
+        // A stray closing brace
+        "}",
+        "x := 1 }",
+        // ':' only forms a token together with '='
+        ":",
+        "x : = 3",
+        "x :y",
+        ":{c}=",
+        // Words that mix digits and letters, and characters outside the language
+        "1abc",
+        "abc1",
+        "a_b",
+        "x := y $ 2",
+        "x := 3!",
+        "[x]",
+        "123456789012345678901234567890",
+        "x := \xc3\xa9",
+        "\x80",
+        "{ \xff } x",
+        "x\x7f",
+        "a<=b",
+        "read x;;",
+    };
+    for (const string &line: lines) compareBoth({line});
+
+    // The comment state carries across lines, also after an error
+    compareBoth({"x := 1 {", "read y;", "} write x", "y := 2"});
+    compareBoth({"{ a", "b", "c }", "d :", "e"});
+
+    // A few results spelled out, so both scanners cannot drift together
+    check(compare({"x{c}y"}, false) == "IDENTIFIER(xy)@1:0 [outside]", "a comment inside a word joins its halves");
+    check(compare({"x}y"}, true) == "IDENTIFIER(y)@1:2 [outside]", "} ends a comment entered on an earlier line");
+    check(compare({"a :b"}, false).find("Error at line 1") == 0, "':' without '=' is an error");
+    check(compare({"x := \xc3\xa9"}, false).find("Error at line 1") == 0, "bytes above 127 are an error");
+
+    // Random lines of tokens, near misses and arbitrary bytes, with a fixed seed
+    const vector<string> pieces = {"if", "then", "end", "repeat", "until", "read", "write", "x", "ab", "12", "0",
+                                   ":=", ":", "=", "<", ";", "+", "-", "*", "/", "(", ")", "{", "}", " ", "\t",
+                                   "_", "a1", "1a", "\x80", "\x01", "!", "ifx", "Read", "[", ":{"};
+    mt19937 random(7);
+    for (int iteration = 0; iteration < 20000; ++iteration) {
+        string line;
+        for (unsigned k = random() % 12; k > 0; --k) {
+            if (random() % 4 == 0) {
+                line += static_cast<char>(random() % 256);
+            } else {
+                line += pieces[random() % pieces.size()];
+            }
+        }
+        compare({line}, random() % 2 == 1);
+    }
+
+    if (failures > 0) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All DFA scanner checks passed" << endl;
+    return 0;
+}
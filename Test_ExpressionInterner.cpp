@@ -0,0 +1,122 @@
+// Regression tests for the ExpressionInterner: repeated expressions on different
+// lines share one subtree, and the semantic checks and the compiled program report
+// the same lines as a parse without interning or with the LL(1) parser. Exits with
+// 1 when a check fails. Build with
+//   g++ -std=c++17 Test_ExpressionInterner.cpp ExpressionInterner.cpp Scanner.cpp Parser.cpp LL1Parser.cpp
+//       Diagnostic.cpp SemanticAnalyzer.cpp CodeGenerator.cpp VirtualMachine.cpp Profiler.cpp RuntimeIO.cpp
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CodeGenerator.h"
+#include "ExpressionInterner.h"
+#include "LL1Parser.h"
+#include "Parser.h"
+#include "Scanner.h"
+#include "SemanticAnalyzer.h"
+#include "VirtualMachine.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string &what) {
+    if (!condition) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+vector<Token> scan(const string &source) {
+    istringstream in(source);
+    bool commentState = false;
+    int lineCount = 1;
+    string line;
+    vector<Token> tokens;
+    while (getline(in, line)) {
+        vector<Token> lineTokens = tryTokenize(line, lineCount++, commentState).valueOrRaise();
+        tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+    }
+    return tokens;
+}
+
+shared_ptr<TreeNode> parseInterned(const string &source, ExpressionInterner &interner) {
+    Parser parser(scan(source));
+    parser.setInterner(&interner);
+    return parser.parse();
+}
+
+// Semantic issues, written values, then the runtime error if there was one
+string run(const TreeNode &root, const vector<int64_t> &input) {
+    string text;
+    for (const SemanticIssue &issue: checkSemantics(root)) text += issue.message + " | ";
+    Program program = compileProgram(root, true);
+    VirtualMachine machine(program);
+    RuntimeInput in(input);
+    vector<int64_t> values;
+    try {
+        RuntimeOutput out(values);
+        machine.run(in, out);
+    } catch (const RuntimeError &e) {
+        text += e.what();
+    }
+    for (int64_t value: values) text += " " + to_string(value);
+    return text;
+}
+
+// Runs `source` parsed three ways and checks they agree; returns the interned run
+string compare(const string &name, const string &source, const vector<int64_t> &input) {
+    ExpressionInterner interner;
+    string interned = run(*parseInterned(source, interner), input);
+    string plain = run(*Parser(scan(source)).parse(), input);
+    string ll1 = run(*parseWith(ParserEngine::LL1, scan(source)), input);
+    check(interned == plain, name + ": \"" + interned + "\", expected \"" + plain + "\"");
+    check(ll1 == plain, name + " (LL(1)): \"" + ll1 + "\", expected \"" + plain + "\"");
+    return interned;
+}
+
+} // namespace
+
+int main() {
+    // The same assignment on every line is stored once
+    string source;
+    for (int line = 1; line <= 2000; ++line) source += "x := n + 1;\n";
+    source += "write x";
+    ExpressionInterner interner;
+    shared_ptr<TreeNode> root = parseInterned(source, interner);
+    const InternStats &stats = interner.stats();
+    check(stats.nodes == 6001 && stats.unique == 4, "2000 lines: " + to_string(stats.nodes) + " nodes, " +
+                                                        to_string(stats.unique) + " unique, expected 6001 and 4");
+    check(stats.bytesSaved > 0, "2000 lines: bytes saved");
+    check(root->children[0]->children[0] == root->children[1999]->children[0],
+          "2000 lines: first and last assignment share their expression");
+
+    // A shared division fails at the line of the statement that runs it
+    string result = compare("division", "read y;\nif 0 < y then x := 7 / y end;\nwrite 1;\nx := 7 / y", {0});
+    check(result.find("Runtime error at line 4") != string::npos, "division: fails at line 4, got \"" + result + "\"");
+
+    // The test of a repeat fails at its UNTIL, also when it is shared with an earlier line
+    result = compare("until", "i := 0;\nwrite 10 / (3 - i);\nrepeat\n  i := i + 1\nuntil 10 / (3 - i) < 0", {});
+    check(result.find("Runtime error at line 5") != string::npos, "until: fails at line 5, got \"" + result + "\"");
+
+    // A shared ill-typed operand is reported on each line it occurs
+    result = compare("boolean", "write (1 < 2) + 1;\nx := 3;\nwrite (1 < 2) + 1", {});
+    check(result.find("Error at line 1") != string::npos && result.find("Error at line 3") != string::npos,
+          "boolean: errors at lines 1 and 3, got \"" + result + "\"");
+    result = compare("condition", "x := 1;\nrepeat\n  x := x + 1\nuntil x + 1", {});
+    check(result.find("Error at line 4") != string::npos, "condition: error at line 4, got \"" + result + "\"");
+
+    // A use before assignment is reported at the statement that reads it
+    result = compare("warning", "if 0 < 1 then read y; write y end;\nwrite y", {5});
+    check(result.find("Warning at line 2") != string::npos, "warning: at line 2, got \"" + result + "\"");
+
+    if (failures > 0) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All expression interner checks passed" << endl;
+    return 0;
+}
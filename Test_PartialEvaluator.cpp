@@ -0,0 +1,145 @@
+// Regression tests for partialEvaluate: the rewritten program must write the same
+// values, raise the same runtime error and leave the same variables as the
+// original, and the prologue must hold what the prefix computed. Exits with 1
+// when a check fails. Build with
+//   g++ -std=c++17 Test_PartialEvaluator.cpp PartialEvaluator.cpp Scanner.cpp Parser.cpp ExpressionInterner.cpp
+//       Diagnostic.cpp CodeGenerator.cpp RangeAnalysis.cpp LoopOptimizer.cpp VirtualMachine.cpp Profiler.cpp
+//       RuntimeIO.cpp
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CodeGenerator.h"
+#include "LoopOptimizer.h"
+#include "Parser.h"
+#include "PartialEvaluator.h"
+#include "RangeAnalysis.h"
+#include "Scanner.h"
+#include "VirtualMachine.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string &what) {
+    if (!condition) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+// Compiles with the passes that run before partialEvaluate
+Program compile(const string &source, bool overflowChecks) {
+    istringstream in(source);
+    bool commentState = false;
+    int lineCount = 1;
+    string line;
+    vector<Token> tokens;
+    while (getline(in, line)) {
+        vector<Token> lineTokens = tryTokenize(line, lineCount++, commentState).valueOrRaise();
+        tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+    }
+    Parser parser(move(tokens));
+    Program program = compileProgram(*parser.parse(), overflowChecks);
+    removeRedundantChecks(program);
+    optimizeLoops(program);
+    return program;
+}
+
+// Written values, the runtime error if there was one, then the variables
+string run(const Program &program, const vector<int64_t> &input) {
+    VirtualMachine machine(program);
+    RuntimeInput in(input);
+    vector<int64_t> values;
+    string outcome;
+    try {
+        RuntimeOutput out(values);
+        machine.run(in, out);
+    } catch (const RuntimeError &e) {
+        outcome = e.what();
+    }
+    string text;
+    for (int64_t value: values) text += to_string(value) + " ";
+    text += outcome + " |";
+    for (int64_t value: machine.variables()) text += " " + to_string(value);
+    return text;
+}
+
+size_t countOps(const Program &program, OpCode op) {
+    size_t count = 0;
+    for (const Instruction &instruction: program.code) count += instruction.op == op;
+    return count;
+}
+
+// Evaluates the prefix of `source` with `maxSteps` and compares both programs on every input
+PartialEvaluationStats evaluate(const string &name, const string &source, uint64_t maxSteps,
+                                const vector<vector<int64_t>> &inputs, Program *result = nullptr,
+                                bool overflowChecks = false) {
+    Program original = compile(source, overflowChecks);
+    Program rewritten = original;
+    PartialEvaluationStats stats = partialEvaluate(rewritten, maxSteps);
+    for (const vector<int64_t> &input: inputs) {
+        string expected = run(original, input);
+        string actual = run(rewritten, input);
+        check(expected == actual, name + ": \"" + actual + "\", expected \"" + expected + "\"");
+    }
+    check(rewritten.code.size() == original.code.size() + stats.prologue, name + ": prologue size");
+    if (result) *result = rewritten;
+    return stats;
+}
+
+} // namespace
+
+int main() {
+    Program program;
+
+    // Without reads the whole output is precomputed and the jump lands on the halt
+    PartialEvaluationStats stats = evaluate("no reads", "x := 3;\nwrite x;\nwrite x * 2;\nwrite x * 2", 1000, {{}},
+                                            &program);
+    check(stats.finished && stats.outputs == 3 && stats.stopLine == 0, "no reads: finished with 3 outputs");
+    const Instruction &jump = program.code[stats.prologue - 1];
+    check(jump.op == OpCode::Jump && program.code[jump.target].op == OpCode::Halt,
+          "no reads: the prologue jumps to the halt");
+    check(countOps(program, OpCode::Write) == 6, "no reads: three precomputed writes in front of the original three");
+
+    // Every written value goes through one scratch register
+    Program original = compile("write 1;\nwrite 2;\nwrite 3;\nwrite 2", false);
+    evaluate("scratch", "write 1;\nwrite 2;\nwrite 3;\nwrite 2", 1000, {{}}, &program);
+    check(program.registerCount == original.registerCount + 1, "scratch: one register added");
+
+    // The prefix stops at the first read and the rest runs on the input
+    stats = evaluate("read", "i := 0;\nrepeat i := i + 1 until 5 < i;\nwrite i;\nread y;\nwrite y + i", 1000,
+                     {{10}, {-6}, {}}, &program);
+    check(!stats.finished && stats.stopLine == 4 && stats.outputs == 1, "read: stops at line 4 after one write");
+
+    // A runtime error in the prefix is left to run time, after the values before it
+    stats = evaluate("error", "x := 0;\nwrite 1;\ny := 5 / x;\nwrite 2", 1000, {{}});
+    check(!stats.finished && stats.stopLine == 3, "error: stops at the division on line 3");
+    stats = evaluate("overflow", "x := 9223372036854775807;\nwrite x;\nx := x + 1", 1000, {{}}, nullptr, true);
+    check(!stats.finished && stats.stopLine == 3, "overflow: stops at the checked addition on line 3");
+
+    // A budget that runs out inside a loop resumes it at run time
+    const string loop = "i := 0;\nrepeat i := i + 3; write i until 20 < i;\nread x";
+    for (uint64_t steps: {1, 2, 5, 17}) {
+        stats = evaluate("budget " + to_string(steps), loop, steps, {{1}});
+        check(stats.steps == steps && stats.stopLine == 0, "budget " + to_string(steps) + ": uses the whole budget");
+    }
+    stats = evaluate("whole loop", loop, 1000, {{1}});
+    check(stats.outputs == 7 && stats.stopLine == 3, "whole loop: seven writes, then stops at the read");
+
+    // No steps, no rewrite
+    original = compile("write 7", false);
+    stats = evaluate("zero", "write 7", 0, {{}}, &program);
+    check(stats.steps == 0 && stats.prologue == 0 && program.code.size() == original.code.size(),
+          "zero: program unchanged");
+
+    if (failures > 0) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All partial evaluation checks passed" << endl;
+    return 0;
+}
@@ -0,0 +1,130 @@
+// Regression tests for removeRedundantChecks. Each program is run with and without
+// the analysis and must give the same output and runtime error; the counts show
+// which checks it dropped. Exits with 1 when a check fails. Build with
+//   g++ -std=c++17 Test_RangeAnalysis.cpp Scanner.cpp Parser.cpp ExpressionInterner.cpp Diagnostic.cpp
+//       CodeGenerator.cpp RangeAnalysis.cpp VirtualMachine.cpp Profiler.cpp RuntimeIO.cpp
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "CodeGenerator.h"
+#include "Parser.h"
+#include "RangeAnalysis.h"
+#include "Scanner.h"
+#include "VirtualMachine.h"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const string &what) {
+    if (!condition) {
+        cerr << "FAILED: " << what << endl;
+        failures++;
+    }
+}
+
+Program compile(const string &source, bool overflowChecks) {
+    istringstream in(source);
+    bool commentState = false;
+    int lineCount = 1;
+    string line;
+    vector<Token> tokens;
+    while (getline(in, line)) {
+        vector<Token> lineTokens = tryTokenize(line, lineCount++, commentState).valueOrRaise();
+        tokens.insert(tokens.end(), lineTokens.begin(), lineTokens.end());
+    }
+    Parser parser(move(tokens));
+    return compileProgram(*parser.parse(), overflowChecks);
+}
+
+// Written values, then the runtime error if there was one
+string run(const Program &program, const vector<int64_t> &input) {
+    VirtualMachine machine(program);
+    RuntimeInput in(input);
+    vector<int64_t> values;
+    string outcome;
+    try {
+        RuntimeOutput out(values);
+        machine.run(in, out);
+    } catch (const RuntimeError &e) {
+        outcome = e.what();
+    }
+    string written;
+    for (int64_t value: values) written += to_string(value) + " ";
+    return written + outcome;
+}
+
+size_t countOps(const Program &program, OpCode op) {
+    size_t count = 0;
+    for (const Instruction &instruction: program.code) count += instruction.op == op;
+    return count;
+}
+
+// Compiles `source` with overflow checks, drops what the analysis proves, and
+// compares both programs on every input
+RangeAnalysisStats analyze(const string &name, const string &source, const vector<vector<int64_t>> &inputs,
+                           Program *result = nullptr) {
+    Program original = compile(source, true);
+    Program optimized = original;
+    RangeAnalysisStats stats = removeRedundantChecks(optimized);
+    for (const vector<int64_t> &input: inputs) {
+        string expected = run(original, input);
+        string actual = run(optimized, input);
+        check(expected == actual, name + ": \"" + actual + "\", expected \"" + expected + "\"");
+    }
+    if (result) *result = optimized;
+    return stats;
+}
+
+} // namespace
+
+int main() {
+    Program program;
+
+    // Dividing by a nonzero constant other than -1 can neither fail nor overflow
+    RangeAnalysisStats stats = analyze("x / 2", "read x;\nwrite x / 2", {{7}, {-7}, {INT64_MIN}, {INT64_MAX}},
+                                       &program);
+    check(stats.zeroChecks == 1 && stats.zeroChecksRemoved == 1, "x / 2: zero check removed");
+    check(countOps(program, OpCode::DivUnchecked) == 1, "x / 2: compiled to DivUnchecked");
+
+    // INT64_MIN / -1 overflows, so that division keeps its check
+    stats = analyze("x / -1", "read x;\ny := 0 - 1;\nwrite x / y", {{5}, {INT64_MIN}}, &program);
+    check(countOps(program, OpCode::DivChecked) == 1, "x / -1: DivChecked kept");
+    check(run(program, {INT64_MIN}).find("Runtime error at line 3") == 0, "x / -1: INT64_MIN / -1 still fails");
+
+    // Same when the dividend is the constant INT64_MIN itself
+    analyze("INT64_MIN / -1", "x := 0 - 9223372036854775807 - 1;\ny := 0 - 1;\nwrite x / y", {{}}, &program);
+    check(countOps(program, OpCode::DivChecked) == 1, "INT64_MIN / -1: DivChecked kept");
+
+    // The divisor is only proven nonzero on the edge where 0 < x holds
+    stats = analyze("guarded x", "read x;\nif 0 < x then write 100 / x end;\nwrite 100 / x", {{4}, {0}, {-3}},
+                    &program);
+    check(stats.zeroChecks == 2 && stats.zeroChecksRemoved == 1, "guarded x: only the guarded zero check removed");
+
+    // An unknown input can overflow, a counted loop cannot
+    stats = analyze("x + 1", "read x;\nwrite x + 1", {{1}, {INT64_MAX}});
+    check(stats.overflowChecks == 1 && stats.overflowChecksRemoved == 0, "x + 1: overflow check kept");
+    stats = analyze("loop", "i := 0;\nrepeat i := i + 1 until 10 < i;\nwrite i * 3", {{}});
+    check(stats.overflowChecks > 0 && stats.overflowChecksRemoved == stats.overflowChecks,
+          "loop: every overflow check removed");
+
+    // A product of two unknowns stays checked
+    stats = analyze("x * y", "read x;\nread y;\nwrite x * y", {{3, 4}, {INT64_MAX, 2}, {INT64_MIN, -1}});
+    check(stats.overflowChecksRemoved == 0, "x * y: overflow check kept");
+
+    // A literal above INT64_MAX is an overflow too, and no check can prove it away
+    analyze("oversized literal", "write 9223372036854775807;\nwrite 9223372036854775808 - 1", {{}}, &program);
+    check(run(program, {}) == "9223372036854775807 Runtime error at line 2 : Integer overflow",
+          "oversized literal: fails at line 2");
+
+    if (failures > 0) {
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All range analysis checks passed" << endl;
+    return 0;
+}
@@ -1,7 +1,32 @@
 #include <iostream>
 #include <fstream>
+#include <chrono>
+#include <iterator>
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
 #include "Scanner.h"
+#include "DfaScanner.h"
 #include "Parser.h"
+#include "LL1Parser.h"
+#include "ParallelParser.h"
+#include "ParallelScanner.h"
+#include "Pipeline.h"
+#include "TreeExport.h"
+#include "LspServer.h"
+#include "SemanticAnalyzer.h"
+#include "CodeGenerator.h"
+#include "LoopOptimizer.h"
+#include "RangeAnalysis.h"
+#include "PartialEvaluator.h"
+#include "VirtualMachine.h"
+#include "Judge.h"
+#include "StreamRunner.h"
+#include "PerfCounters.h"
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 #include "TreeNode.h"
 
 using namespace std;
@@ -10,13 +35,22 @@ using namespace std;
 void display_tree(const shared_ptr<TreeNode> &node, const string &prefix = "", bool isLast = true) {
     if (!node) return;
 
+    // A sequence shows as its statements; the first takes the connector of the sequence
+    if (node->kind == NodeKind::Seq) {
+        for (size_t i = 0; i < node->children.size(); ++i) {
+            display_tree(node->children[i], prefix, i == 0 ? isLast : i == node->children.size() - 1);
+        }
+        return;
+    }
+
     // Determine connector style for ASCII
     string connector = isLast ? "\\-- " : "|-- ";
 
-    // Display node name and value
-    cout << prefix << connector << node->name;
-    if (!node->value.empty()) {
-        cout << " (" << node->value << ")";
+    // Display node kind and value
+    cout << prefix << connector << kindName(node->kind);
+    string label = node->label();
+    if (!label.empty()) {
+        cout << " (" << label << ")";
     }
     cout << endl;
 
@@ -28,11 +62,6 @@ void display_tree(const shared_ptr<TreeNode> &node, const string &prefix = "", b
         bool lastChild = (i == node->children.size() - 1);
         display_tree(node->children[i], childPrefix, lastChild);
     }
-
-    // Recursively display siblings
-    for (size_t i = 0; i < node->siblings.size(); ++i) {
-        display_tree(node->siblings[i], prefix, (i == node->siblings.size() - 1));
-    }
 }
 
 /*void print_tree_details(const shared_ptr<TreeNode>& node) {
@@ -82,10 +111,453 @@ void display_tree(const shared_ptr<TreeNode> &node, const string &prefix = "", b
     }
 }*/
 
+// Structural comparison used to check that both parser engines agree
+bool same_tree(const shared_ptr<TreeNode> &a, const shared_ptr<TreeNode> &b) {
+    if (!a || !b) return a == b;
+    if (a->kind != b->kind || a->op != b->op || a->value != b->value || a->line != b->line) return false;
+    if (a->children.size() != b->children.size()) return false;
+    for (size_t i = 0; i < a->children.size(); ++i) {
+        if (!same_tree(a->children[i], b->children[i])) return false;
+    }
+    return true;
+}
+
+// Times `runs` parses of the same tokens with each engine
+void benchmark_engines(const vector<Token> &tokens, int runs, unsigned threads) {
+    shared_ptr<TreeNode> trees[3];
+    const char *names[3] = {"recursive descent", "LL(1) table", "parallel recursive descent"};
+
+    for (int e = 0; e < 3; ++e) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i) {
+            if (e == 0) trees[e] = parseWith(ParserEngine::RecursiveDescent, tokens);
+            if (e == 1) trees[e] = parseWith(ParserEngine::LL1, tokens);
+            if (e == 2) trees[e] = parseParallel(tokens, threads);
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        cout << names[e] << ": " << elapsed.count() / runs << " ms per parse (" << runs << " runs)" << endl;
+    }
+    bool match = same_tree(trees[0], trees[1]) && same_tree(trees[0], trees[2]);
+    cout << (match ? "Trees match" : "Trees differ") << endl;
+}
+
+// Times `runs` scans of the same lines with each scanner engine
+void benchmark_scanners(const vector<string> &lines, int runs) {
+    vector<Token> tokens[2];
+    const char *names[2] = {"token map scanner", "DFA scanner"};
+    const ScannerEngine engines[2] = {ScannerEngine::TokenMap, ScannerEngine::Dfa};
+
+    for (int e = 0; e < 2; ++e) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i) {
+            tokens[e].clear();
+            bool commentState = false;
+            for (size_t k = 0; k < lines.size(); ++k) {
+                vector<Token> lineTokens =
+                    tryTokenizeWith(engines[e], lines[k], static_cast<int>(k + 1), commentState).valueOrRaise();
+                tokens[e].insert(tokens[e].end(), make_move_iterator(lineTokens.begin()),
+                                 make_move_iterator(lineTokens.end()));
+            }
+        }
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        cout << names[e] << ": " << elapsed.count() / runs << " ms per scan (" << runs << " runs)" << endl;
+    }
+    bool match = tokens[0].size() == tokens[1].size() &&
+                 equal(tokens[0].begin(), tokens[0].end(), tokens[1].begin(), [](const Token &a, const Token &b) {
+                     return a.value == b.value && a.type == b.type && a.line == b.line && a.column == b.column;
+                 });
+    cout << (match ? "Tokens match" : "Tokens differ") << endl;
+}
+
+// Scans a whole stream, line by line or in parallel chunks
+vector<Token> read_tokens(istream &in, bool parallel, unsigned threads, ScannerEngine scanner) {
+    vector<Token> outputTokens;
+    if (parallel) {
+        // Scan the whole file at once on worker threads
+        string source((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        return tokenizeParallel(source, threads, scanner);
+    }
+
+    // Read input file line by line
+    int lineCount = 1;
+    string line;
+    while (getline(in, line)) {
+        vector<Token> tokens = tryTokenizeWith(scanner, line, lineCount, inComment).valueOrRaise();
+        outputTokens.insert(outputTokens.end(), tokens.begin(), tokens.end());
+        lineCount++;
+    }
+    return outputTokens;
+}
+
+// Recursive descent parse sharing repeated expressions; reports the saving on stderr
+shared_ptr<TreeNode> parse_hash_consed(const vector<Token> &tokens) {
+    ExpressionInterner interner;
+    Parser parser(tokens);
+    parser.setInterner(&interner);
+    shared_ptr<TreeNode> syntaxTree = parser.parse();
+    const InternStats &stats = interner.stats();
+    cerr << "Hash-consing: " << stats.nodes << " expression nodes, " << stats.unique << " unique, "
+         << stats.bytesSaved / 1024 << " KiB saved" << endl;
+    return syntaxTree;
+}
+
+size_t count_nodes(const TreeNode &node) {
+    size_t count = 1;
+    for (const auto &child: node.children) {
+        if (child) count += count_nodes(*child);
+    }
+    return count;
+}
+
+// How run_program compiles
+struct CompileOptions {
+    bool loopOptimizations = true;
+    bool overflowChecks = false;
+    bool rangeAnalysis = true;
+    uint64_t partialEvaluationSteps = 0; // 0 to run nothing at compile time
+};
+
+// Runs the program on stdin/stdout; with `profile`, writes <input>.profile with the
+// annotated source and hot loops, and <input>.folded for flame graphs. With `stats`,
+// reports the instruction and check counts on stderr.
+int run_program(const TreeNode &syntaxTree, const string &inputFile, bool profile, const CompileOptions &options,
+                bool stats, PhaseCounters &phases) {
+    phases.begin();
+    Program program = compileProgram(syntaxTree, options.overflowChecks);
+    size_t compiled = program.code.size();
+    RangeAnalysisStats rangeStats;
+    if (options.rangeAnalysis) rangeStats = removeRedundantChecks(program);
+    LoopOptimizationStats loopStats;
+    if (options.loopOptimizations) loopStats = optimizeLoops(program);
+    PartialEvaluationStats evaluation;
+    if (options.partialEvaluationSteps > 0) evaluation = partialEvaluate(program, options.partialEvaluationSteps);
+    phases.end("compile", program.code.size(), "instruction");
+    if (stats) {
+        cerr << "Instructions: " << compiled << " compiled";
+        if (options.loopOptimizations) {
+            cerr << ", " << program.code.size() << " after loop optimization (" << loopStats.loops << " loops, "
+                 << loopStats.hoisted << " hoisted, " << loopStats.strengthReduced << " strength-reduced)";
+        }
+        cerr << endl;
+        if (options.rangeAnalysis) {
+            size_t checks = rangeStats.zeroChecks + rangeStats.overflowChecks;
+            size_t removed = rangeStats.zeroChecksRemoved + rangeStats.overflowChecksRemoved;
+            cerr << "Checks: " << removed << " of " << checks << " removed by range analysis ("
+                 << (checks > 0 ? removed * 100 / checks : 0) << "%; division by zero " << rangeStats.zeroChecksRemoved
+                 << " of " << rangeStats.zeroChecks << ", overflow " << rangeStats.overflowChecksRemoved << " of "
+                 << rangeStats.overflowChecks << ")" << endl;
+        }
+        if (options.partialEvaluationSteps > 0) {
+            cerr << "Partial evaluation: " << evaluation.steps << " instructions run at compile time, "
+                 << evaluation.outputs << " values written, ";
+            if (evaluation.finished) {
+                cerr << "program finished";
+            } else if (evaluation.stopLine > 0) {
+                cerr << "stopped at line " << evaluation.stopLine;
+            } else {
+                cerr << "step budget used up";
+            }
+            cerr << endl;
+        }
+    }
+
+    VirtualMachine machine(program);
+    RuntimeInput input(cin);
+    RuntimeOutput output(cout);
+    input.tie(&output);
+    uint64_t steps = 0;
+    int status = 0;
+    if (!profile) {
+        if (!stats && !phases.enabled()) {
+            machine.run(input, output);
+            return 0;
+        }
+        phases.begin();
+        try {
+            machine.run(input, output, ExecutionLimits(), steps);
+        } catch (const RuntimeError &e) {
+            output.flush();
+            cerr << e.what() << endl;
+            status = 1;
+        }
+        output.flush();
+        phases.end("run", steps, "instruction");
+        if (stats) cerr << "Executed: " << steps << " instructions" << endl;
+        return status;
+    }
+
+    ExecutionProfile executionProfile;
+    try {
+        machine.run(input, output, executionProfile);
+    } catch (const RuntimeError &e) {
+        output.flush();
+        cerr << e.what() << endl;
+        status = 1;
+    }
+    output.flush();
+    if (stats) {
+        for (uint64_t count: executionProfile.counts) steps += count;
+        cerr << "Executed: " << steps << " instructions" << endl;
+    }
+
+    ifstream in(inputFile);
+    vector<string> source;
+    string line;
+    while (getline(in, line)) source.push_back(line);
+
+    ofstream listing(inputFile + ".profile");
+    ofstream folded(inputFile + ".folded");
+    if (!listing.is_open() || !folded.is_open()) {
+        throw runtime_error("Error: Could not open output file.");
+    }
+    writeAnnotatedListing(program, executionProfile, source, listing);
+    writeFoldedStacks(program, executionProfile, folded);
+    return status;
+}
+
+// Writes <file>.dot or <file>.svg next to every input; a bad file does not stop the batch
+int export_batch(const vector<string> &files, const string &format, ParserEngine engine, ScannerEngine scanner) {
+    int failures = 0;
+    for (const string &file: files) {
+        try {
+            ifstream in(file);
+            if (!in.is_open()) {
+                throw runtime_error("Error: Could not open input file.");
+            }
+            inComment = false;
+            auto syntaxTree = parseWith(engine, read_tokens(in, false, 0, scanner));
+
+            ofstream out(file + "." + format);
+            if (!out.is_open()) {
+                throw runtime_error("Error: Could not open output file.");
+            }
+            if (format == "dot") {
+                exportDot(syntaxTree, out);
+            } else {
+                exportSvg(syntaxTree, out);
+            }
+        } catch (const runtime_error &e) {
+            cerr << file << ": " << e.what() << endl;
+            failures++;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+
+// Grades every file of the submissions directory against the tests directory
+int judge_batch(const vector<string> &paths, const JudgeLimits &limits, unsigned threads) {
+    try {
+        if (paths.size() != 2) {
+            throw runtime_error("Error: --judge needs a submissions directory and a tests directory.");
+        }
+        vector<string> submissions;
+        for (const auto &entry: filesystem::directory_iterator(paths[0])) {
+            if (entry.is_regular_file()) submissions.push_back(entry.path().string());
+        }
+        sort(submissions.begin(), submissions.end());
+        vector<TestCase> tests = loadTestCases(paths[1]);
+
+        auto start = chrono::steady_clock::now();
+        vector<JudgeResult> results = judgeSubmissions(submissions, tests, limits, threads);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+        writeJudgeReport(results, cout);
+        cout << submissions.size() << " submissions x " << tests.size() << " tests in " << elapsed.count()
+             << " ms" << endl;
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Runs the program arriving on stdin statement by statement; read statements take
+// their integers from the file in `paths`, if any
+int stream_program(const vector<string> &paths, const CompileOptions &options, bool stats) {
+    ifstream valuesFile;
+    if (!paths.empty()) {
+        valuesFile.open(paths[0]);
+        if (!valuesFile.is_open()) {
+            cerr << "Error: Could not open input file." << endl;
+            return 1;
+        }
+    }
+    RuntimeInput input = paths.empty() ? RuntimeInput(string()) : RuntimeInput(valuesFile);
+    RuntimeOutput output(cout);
+    input.tie(&output);
+
+    StreamOptions streamOptions;
+    streamOptions.loopOptimizations = options.loopOptimizations;
+    streamOptions.overflowChecks = options.overflowChecks;
+    streamOptions.rangeAnalysis = options.rangeAnalysis;
+    try {
+        StreamStats streamStats = runStreaming(cin, input, output, streamOptions);
+        output.flush();
+        if (stats) {
+            cerr << "Streamed: " << streamStats.statements << " statements in " << streamStats.chunks
+                 << " chunks, at most " << streamStats.maxPending << " tokens held, " << streamStats.variables
+                 << " variables" << endl;
+        }
+    } catch (const runtime_error &e) {
+        output.flush();
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Whether `arg` is the option `name` on its own or followed by "=value"
+bool is_option(const string &arg, const string &name) {
+    return arg.compare(0, name.size(), name) == 0 && (arg.size() == name.size() || arg[name.size()] == '=');
+}
+
+// Reads the number that follows the first `skip` characters of `arg`; prints an
+// error and returns false when it is missing, malformed or out of range
+template<typename T>
+bool parse_option_value(const string &arg, size_t skip, T &value) {
+    const char *first = arg.data() + skip;
+    const char *last = arg.data() + arg.size();
+    from_chars_result result = from_chars(first, last, value);
+    if (first != last && result.ec == errc() && result.ptr == last) return true;
+    cerr << "Invalid value for " << arg.substr(0, skip - 1) << ": " << arg.substr(skip) << endl;
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    // Lets cin buffer stdin, so the runtime reads it in blocks
+    ios::sync_with_stdio(false);
 
-int main() {
     string inputFile = R"(D:\Mohanad.Khh\ASU Senior 1 - Fall '23\Design Of Compilers\Input_File.txt)";
     string outputFile = R"(D:\Mohanad.Khh\ASU Senior 1 - Fall '23\Design Of Compilers\Output_File.txt)";
+    ParserEngine engine = ParserEngine::RecursiveDescent;
+    ScannerEngine scanner = ScannerEngine::TokenMap;
+    int benchRuns = 0;
+    bool parallel = false;
+    bool pipelined = false;
+    bool execute = false;
+    bool profile = false;
+    bool judge = false;
+    bool stream = false;
+    CompileOptions compileOptions;
+    bool stats = false;
+    bool perf = false;
+    bool hashCons = false;
+    JudgeLimits judgeLimits;
+    judgeLimits.execution.maxSteps = 100000000;
+    judgeLimits.execution.timeout = chrono::milliseconds(2000);
+    judgeLimits.maxVariables = 10000;
+    unsigned threads = 0;
+    string exportFormat;
+
+    // Usage: [input file] [token output file] [--engine=rd|ll1] [--scanner=map|dfa]
+    //        [--parallel[=threads] | --pipeline] [--bench=N] [--run | --profile] [--no-loop-opt] [--checked]
+    //        [--no-range-opt] [--partial-eval[=steps]] [--stats] [--perf] [--hash-cons]
+    //        --export=dot|svg input files...
+    //        --judge submissions-dir tests-dir [--steps=N] [--timeout=ms] [--max-vars=N] [--parallel=threads]
+    //                [--no-loop-opt] [--checked] [--no-range-opt] [--partial-eval[=steps]] [--batch[=lanes]]
+    //        --stream [values file] [--no-loop-opt] [--checked] [--no-range-opt] [--stats]
+    //        --lsp
+    vector<string> paths;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--engine=rd") {
+            engine = ParserEngine::RecursiveDescent;
+        } else if (arg == "--engine=ll1") {
+            engine = ParserEngine::LL1;
+        } else if (arg == "--scanner=map") {
+            scanner = ScannerEngine::TokenMap;
+        } else if (arg == "--scanner=dfa") {
+            scanner = ScannerEngine::Dfa;
+        } else if (is_option(arg, "--parallel")) {
+            parallel = true;
+            threads = 0;
+            if (arg != "--parallel" && !parse_option_value(arg, 11, threads)) return 1;
+        } else if (arg == "--run") {
+            execute = true;
+        } else if (arg == "--profile") {
+            execute = profile = true;
+        } else if (arg == "--no-loop-opt") {
+            compileOptions.loopOptimizations = judgeLimits.loopOptimizations = false;
+        } else if (arg == "--checked") {
+            compileOptions.overflowChecks = judgeLimits.overflowChecks = true;
+        } else if (arg == "--no-range-opt") {
+            compileOptions.rangeAnalysis = judgeLimits.rangeAnalysis = false;
+        } else if (is_option(arg, "--partial-eval")) {
+            uint64_t steps = 1000000;
+            if (arg != "--partial-eval" && !parse_option_value(arg, 15, steps)) return 1;
+            compileOptions.partialEvaluationSteps = judgeLimits.partialEvaluationSteps = steps;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg == "--perf") {
+            perf = true;
+        } else if (arg == "--hash-cons") {
+            hashCons = true;
+        } else if (arg == "--judge") {
+            judge = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg.rfind("--steps=", 0) == 0) {
+            if (!parse_option_value(arg, 8, judgeLimits.execution.maxSteps)) return 1;
+        } else if (arg.rfind("--timeout=", 0) == 0) {
+            // 0 means no limit; a negative one, or one the nanosecond clock cannot hold, is refused
+            int64_t milliseconds = 0;
+            if (!parse_option_value(arg, 10, milliseconds)) return 1;
+            if (milliseconds < 0 ||
+                milliseconds > chrono::duration_cast<chrono::milliseconds>(chrono::nanoseconds::max()).count()) {
+                cerr << "Invalid value for --timeout: " << arg.substr(10) << endl;
+                return 1;
+            }
+            judgeLimits.execution.timeout = chrono::milliseconds(milliseconds);
+        } else if (is_option(arg, "--batch")) {
+            judgeLimits.batchLanes = 64;
+            if (arg != "--batch" && !parse_option_value(arg, 8, judgeLimits.batchLanes)) return 1;
+        } else if (arg.rfind("--max-vars=", 0) == 0) {
+            if (!parse_option_value(arg, 11, judgeLimits.maxVariables)) return 1;
+        } else if (arg == "--pipeline") {
+            pipelined = true;
+        } else if (is_option(arg, "--bench")) {
+            benchRuns = 100;
+            if (arg != "--bench" && !parse_option_value(arg, 8, benchRuns)) return 1;
+        } else if (arg == "--lsp") {
+#ifdef _WIN32
+            // LSP frames count bytes, so no newline translation
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            LspServer server;
+            return server.run(cin, cout);
+        } else if (arg == "--export=dot" || arg == "--export=svg") {
+            exportFormat = arg.substr(9);
+        } else if (arg.rfind("--", 0) == 0) {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (!exportFormat.empty()) {
+        return export_batch(paths, exportFormat, engine, scanner);
+    }
+    if (judge) {
+        return judge_batch(paths, judgeLimits, threads);
+    }
+    if (stream) {
+        return stream_program(paths, compileOptions, stats);
+    }
+    if (hashCons && (parallel || pipelined || engine != ParserEngine::RecursiveDescent)) {
+        cerr << "Error: --hash-cons needs the serial recursive-descent parser, "
+             << "not --parallel, --pipeline or --engine=ll1" << endl;
+        return 1;
+    }
+    if (pipelined && (parallel || engine != ParserEngine::RecursiveDescent || scanner != ScannerEngine::TokenMap)) {
+        cerr << "Error: --pipeline scans with the token map and parses with recursive descent, "
+             << "not with --parallel, --engine=ll1 or --scanner=dfa" << endl;
+        return 1;
+    }
+    if (paths.size() > 0) inputFile = paths[0];
+    if (paths.size() > 1) outputFile = paths[1];
 
 
     ifstream inFile(inputFile);
@@ -100,15 +572,17 @@ int main() {
             throw runtime_error("Error: Could not open output file.");
         }
 
-        int lineCount = 1;
-        string line;
+        // In pipelined mode the tokens are parsed while the file is still being scanned
         vector<Token> outputTokens;
-
-        // Read input file line by line
-        while (getline(inFile, line)) {
-            vector<Token> tokens = tokenize(line, lineCount);
-            outputTokens.insert(outputTokens.end(), tokens.begin(), tokens.end());
-            lineCount++;
+        shared_ptr<TreeNode> syntaxTree;
+        PhaseCounters phases(perf && benchRuns == 0);
+        phases.begin();
+        if (pipelined && benchRuns == 0) {
+            syntaxTree = parsePipelined(inFile, outputTokens);
+            phases.end("scan+parse", outputTokens.size(), "token");
+        } else {
+            outputTokens = read_tokens(inFile, parallel, threads, scanner);
+            phases.end("scan", outputTokens.size(), "token");
         }
 
         // Write tokens to the output file
@@ -116,14 +590,51 @@ int main() {
             outFile << token.value << "," << token.type << endl;
         }
 
+        if (benchRuns > 0) {
+            ifstream source(inputFile);
+            vector<string> lines;
+            string line;
+            while (getline(source, line)) lines.push_back(line);
+            benchmark_scanners(lines, benchRuns);
+            benchmark_engines(outputTokens, benchRuns, threads);
+            return 0;
+        }
+
         // Parse tokens
-        Parser parser(outputTokens);
-        auto syntaxTree = parser.parse();
+        if (!syntaxTree) {
+            phases.begin();
+            if (hashCons) {
+                syntaxTree = parse_hash_consed(outputTokens);
+            } else {
+                syntaxTree = parallel ? parseParallel(outputTokens, threads) : parseWith(engine, outputTokens);
+            }
+            phases.end("parse", 0, "node");
+        }
+        // Counted outside the measured phases, so the walk does not show up in them
+        size_t nodes = phases.enabled() ? count_nodes(*syntaxTree) : 0;
+        phases.setUnits("parse", nodes);
 
         // Display the syntax tree
         //print_tree_details(syntaxTree);
         // cout << endl << endl;
-        display_tree(syntaxTree);
+        if (!execute) display_tree(syntaxTree);
+
+        // Type errors fail the run; use-before-assignment is only a warning
+        bool semanticError = false;
+        phases.begin();
+        vector<SemanticIssue> issues = checkSemantics(*syntaxTree);
+        phases.end("semantic", nodes, "node");
+        for (const SemanticIssue &issue: issues) {
+            cerr << issue.message << endl;
+            semanticError = semanticError || issue.error;
+        }
+
+        int status = semanticError ? 1 : 0;
+        if (execute && !semanticError) {
+            status = run_program(*syntaxTree, inputFile, profile, compileOptions, stats, phases);
+        }
+        phases.write(cerr);
+        if (status != 0) return status;
 
     } catch (const runtime_error &e) {
         // Handle any runtime error by printing the message
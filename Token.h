@@ -9,6 +9,7 @@ struct Token {
     string value;
     string type;
     int line;
+    int column = 0; // offset of the first character within its line
 };
 
 #endif // TOKEN_H
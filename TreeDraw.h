@@ -4,11 +4,8 @@
 #include <QGraphicsScene>
 #include <QGraphicsView>
 #include <QWidget>
-#include <QGraphicsRectItem>
-#include <QGraphicsEllipseItem>
-#include <map>
-#include <set>
 #include "TreeNode.h"
+#include "SyntaxTreeItem.h"
 
 class TreeDraw : public QWidget
 {
@@ -17,20 +14,17 @@ public:
     explicit TreeDraw(QWidget *parent = nullptr);
     void drawSyntaxTree(std::shared_ptr<TreeNode> root);
 
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
 private:
     QGraphicsScene *scene;
     QGraphicsView *view;
-    void drawNode(std::shared_ptr<TreeNode> node, int x, int y, std::map<int, int> &currentForVLevel);
+    SyntaxTreeItem *treeItem;
     int nodeHeight = 50;
     int nodeWidth = 100;
-    int xOffset = 150;
+    int xGap = 50;
     int yOffset = 100;
-    QFont font;
-    QPen redPen;
-    std::set<std::pair<int, int>> drawnPositions; // To keep track of drawn positions
-
-    bool isPositionOccupied(int x, int y);
-    std::pair<int, int> findNonOverlappingPosition(int x, int y);
 };
 
 #endif // TREEDRAW_H
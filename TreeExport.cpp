@@ -0,0 +1,177 @@
+#include "TreeExport.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const int nodeWidth = 100;
+const int nodeHeight = 50;
+const int columnWidth = 120;
+const int levelHeight = 100;
+const int margin = 50;
+
+// Escapes the characters that are special in XML text and DOT strings
+string escape(const string &text, bool xml) {
+    string out;
+    for (char c: text) {
+        if (xml && c == '<') out += "&lt;";
+        else if (xml && c == '>') out += "&gt;";
+        else if (xml && c == '&') out += "&amp;";
+        else if (c == '"') out += xml ? "&quot;" : "\\\"";
+        else out += c;
+    }
+    return out;
+}
+
+class DotWriter {
+public:
+    explicit DotWriter(ostream &out) : out(out) {}
+
+    // A sequence is drawn as its statements, each linked to the previous one
+    void child(const TreeNode &node, long parent) {
+        if (node.kind != NodeKind::Seq) {
+            statement(node, parent);
+            return;
+        }
+        long previous = -1;
+        for (const auto &next: node.children) {
+            if (!next) continue;
+            long id = statement(*next, previous < 0 ? parent : -1);
+            if (previous < 0) {
+                previous = id;
+                continue;
+            }
+            out << "  n" << previous << " -> n" << id << " [style=dashed];\n";
+            out << "  { rank=same; n" << previous << "; n" << id << "; }\n";
+            previous = id;
+        }
+    }
+
+private:
+    ostream &out;
+    long nextId = 0;
+
+    long statement(const TreeNode &node, long parent) {
+        long id = nextId++;
+        string label = node.label();
+        out << "  n" << id << " [label=\"" << kindName(node.kind);
+        if (!label.empty()) out << "\\n(" << escape(label, false) << ")";
+        out << "\", shape=" << (isStatement(node.kind) ? "box" : "ellipse") << "];\n";
+        if (parent >= 0) out << "  n" << parent << " -> n" << id << ";\n";
+        for (const auto &next: node.children) {
+            if (next) child(*next, id);
+        }
+        return id;
+    }
+};
+
+// Every childless node takes the next column; a parent is centred over its children.
+// Subtrees therefore own disjoint column ranges and never overlap.
+class SvgWriter {
+public:
+    explicit SvgWriter(ostream *out) : out(out) {}
+
+    int columns = 0;
+    int maxDepth = 0;
+
+    // Places each statement of a sequence and links it to the previous one;
+    // returns the centre x of the first
+    double child(const TreeNode &node, int depth) {
+        if (node.kind != NodeKind::Seq) return this->node(node, depth);
+        double first = 0;
+        double previous = 0;
+        bool any = false;
+        for (const auto &statement: node.children) {
+            if (!statement) continue;
+            double x = this->node(*statement, depth);
+            if (!any) {
+                first = previous = x;
+                any = true;
+                continue;
+            }
+            if (out) {
+                double y = top(depth) + nodeHeight / 2.0;
+                *out << "<line x1=\"" << previous + nodeWidth / 2.0 << "\" y1=\"" << y << "\" x2=\""
+                     << x - nodeWidth / 2.0 << "\" y2=\"" << y << "\" class=\"edge\"/>\n";
+            }
+            previous = x;
+        }
+        return first;
+    }
+
+private:
+    ostream *out; // null while measuring
+
+    static double top(int depth) { return margin + depth * levelHeight; }
+
+    // Returns the centre x of the node after drawing its subtree
+    double node(const TreeNode &node, int depth) {
+        maxDepth = max(maxDepth, depth);
+        double heads[3];
+        size_t count = 0;
+        double first = 0;
+        double last = 0;
+        for (const auto &next: node.children) {
+            if (!next) continue;
+            double x = child(*next, depth + 1);
+            if (count == 0) first = x;
+            last = x;
+            if (count < 3) heads[count] = x;
+            count++;
+        }
+        double x = count == 0 ? margin + (columns++) * columnWidth + nodeWidth / 2.0 : (first + last) / 2;
+        if (!out) return x;
+
+        for (size_t i = 0; i < min<size_t>(count, 3); ++i) {
+            *out << "<line x1=\"" << x << "\" y1=\"" << top(depth) + nodeHeight << "\" x2=\"" << heads[i]
+                 << "\" y2=\"" << top(depth + 1) << "\" class=\"edge\"/>\n";
+        }
+        double y = top(depth);
+        if (isStatement(node.kind)) {
+            *out << "<rect x=\"" << x - nodeWidth / 2.0 << "\" y=\"" << y << "\" width=\"" << nodeWidth
+                 << "\" height=\"" << nodeHeight << "\"/>\n";
+        } else {
+            *out << "<ellipse cx=\"" << x << "\" cy=\"" << y + nodeHeight / 2.0 << "\" rx=\"" << nodeWidth / 2.0
+                 << "\" ry=\"" << nodeHeight / 2.0 << "\"/>\n";
+        }
+        string label = node.label();
+        double textY = label.empty() ? y + nodeHeight / 2.0 + 5 : y + nodeHeight / 2.0 - 4;
+        *out << "<text x=\"" << x << "\" y=\"" << textY << "\">" << kindName(node.kind) << "</text>\n";
+        if (!label.empty()) {
+            *out << "<text x=\"" << x << "\" y=\"" << textY + 16 << "\">(" << escape(label, true)
+                 << ")</text>\n";
+        }
+        return x;
+    }
+};
+
+} // namespace
+
+void exportDot(const shared_ptr<TreeNode> &root, ostream &out) {
+    out << "digraph SyntaxTree {\n";
+    out << "  node [fontname=\"Arial\"];\n";
+    out << "  edge [color=red];\n";
+    if (root) {
+        DotWriter writer(out);
+        writer.child(*root, -1);
+    }
+    out << "}\n";
+}
+
+void exportSvg(const shared_ptr<TreeNode> &root, ostream &out) {
+    SvgWriter measure(nullptr);
+    if (root) measure.child(*root, 0);
+    int width = 2 * margin + max(measure.columns, 1) * columnWidth;
+    int height = 2 * margin + measure.maxDepth * levelHeight + nodeHeight;
+
+    out << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << width << "\" height=\"" << height
+        << "\" viewBox=\"0 0 " << width << " " << height << "\">\n";
+    out << "<style>rect,ellipse{fill:white;stroke:black}.edge{stroke:red}"
+           "text{font:12px Arial;text-anchor:middle}</style>\n";
+    if (root) {
+        SvgWriter writer(&out);
+        writer.child(*root, 0);
+    }
+    out << "</svg>\n";
+}
@@ -0,0 +1,20 @@
+#ifndef TREEEXPORT_H
+#define TREEEXPORT_H
+
+#include <memory>
+#include <ostream>
+#include "TreeNode.h"
+
+using namespace std;
+
+// Headless syntax tree output. Both formats are written while walking the tree,
+// keeping only the current path in memory, so they need no display and no scene.
+
+// Graphviz DOT; statements of a sequence are kept on one rank
+void exportDot(const shared_ptr<TreeNode> &root, ostream &out);
+
+// SVG drawn like TreeDraw: statements as boxes, expressions as ellipses, siblings
+// side by side. A first walk measures the tree, the second streams the drawing.
+void exportSvg(const shared_ptr<TreeNode> &root, ostream &out);
+
+#endif // TREEEXPORT_H
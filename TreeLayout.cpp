@@ -0,0 +1,186 @@
+#include "TreeLayout.h"
+#include <algorithm>
+
+using namespace std;
+
+TreeLayout::TreeLayout(double nodeWidth, double horizontalGap, double levelHeight)
+    : nodeWidth(nodeWidth), distance(nodeWidth + horizontalGap), levelHeight(levelHeight) {}
+
+void TreeLayout::compute(const shared_ptr<TreeNode> &root, double margin,
+                         const unordered_set<const TreeNode *> *collapsed) {
+    this->collapsed = collapsed;
+    nodes.clear();
+    placed.clear();
+    right = bottom = 0;
+    if (!root) return;
+
+    // Node 0 is a virtual parent for the top-level statement sequence
+    nodes.emplace_back();
+    addChild(0, root);
+    for (Node &node: nodes) {
+        node.ancestor = static_cast<int>(&node - nodes.data());
+    }
+
+    firstWalk(0);
+    placed.reserve(nodes.size() - 1);
+    for (int child: nodes[0].children) {
+        secondWalk(child, -nodes[0].prelim, 0, margin);
+    }
+
+    // Shift everything right so the leftmost node starts at the margin
+    double left = 0;
+    for (const Item &item: placed) left = min(left, item.x);
+    for (Item &item: placed) {
+        item.x += margin - left;
+        right = max(right, item.x + nodeWidth + margin);
+        bottom = max(bottom, item.y + margin);
+    }
+}
+
+// Sequences are not drawn: their statements become children of the parent, side by side
+void TreeLayout::addChild(int parent, const shared_ptr<TreeNode> &child) {
+    int from = parent == 0 ? -1 : parent;
+    if (child->kind != NodeKind::Seq) {
+        nodes[addNode(parent, child)].edgeFrom = from;
+        return;
+    }
+    int previous = -1;
+    for (const auto &statement: child->children) {
+        if (!statement) continue;
+        int index = addNode(parent, statement);
+        nodes[index].edgeFrom = previous < 0 ? from : previous;
+        nodes[index].siblingEdge = previous >= 0;
+        previous = index;
+    }
+}
+
+int TreeLayout::addNode(int parent, const shared_ptr<TreeNode> &node) {
+    int index = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+    nodes[index].source = node.get();
+    nodes[index].parent = parent;
+    nodes[index].number = static_cast<int>(nodes[parent].children.size());
+    nodes[parent].children.push_back(index);
+    if (collapsed && collapsed->count(node.get())) return index;
+    for (const auto &child: node->children) {
+        if (child) addChild(index, child);
+    }
+    return index;
+}
+
+int TreeLayout::nextLeft(int v) const {
+    return nodes[v].children.empty() ? nodes[v].thread : nodes[v].children.front();
+}
+
+int TreeLayout::nextRight(int v) const {
+    return nodes[v].children.empty() ? nodes[v].thread : nodes[v].children.back();
+}
+
+void TreeLayout::firstWalk(int v) {
+    Node &node = nodes[v];
+    int leftSibling = node.number > 0 ? nodes[node.parent].children[node.number - 1] : -1;
+
+    if (node.children.empty()) {
+        node.prelim = leftSibling >= 0 ? nodes[leftSibling].prelim + distance : 0;
+        return;
+    }
+
+    int defaultAncestor = node.children.front();
+    for (int child: node.children) {
+        firstWalk(child);
+        defaultAncestor = apportion(child, defaultAncestor);
+    }
+    executeShifts(v);
+
+    double midpoint = (nodes[node.children.front()].prelim + nodes[node.children.back()].prelim) / 2;
+    if (leftSibling >= 0) {
+        node.prelim = nodes[leftSibling].prelim + distance;
+        node.mod = node.prelim - midpoint;
+    } else {
+        node.prelim = midpoint;
+    }
+}
+
+// Pushes the subtree of v right until its left contour clears the right contour
+// of every subtree to its left, threading the contours as it goes
+int TreeLayout::apportion(int v, int defaultAncestor) {
+    const Node &node = nodes[v];
+    if (node.number == 0) return defaultAncestor;
+
+    const vector<int> &siblings = nodes[node.parent].children;
+    int vip = v;                            // inner right contour
+    int vop = v;                            // outer right contour
+    int vim = siblings[node.number - 1];    // inner left contour
+    int vom = siblings.front();             // outer left contour
+    double sip = nodes[vip].mod;
+    double sop = nodes[vop].mod;
+    double sim = nodes[vim].mod;
+    double som = nodes[vom].mod;
+
+    while (nextRight(vim) >= 0 && nextLeft(vip) >= 0) {
+        vim = nextRight(vim);
+        vip = nextLeft(vip);
+        vom = nextLeft(vom);
+        vop = nextRight(vop);
+        nodes[vop].ancestor = v;
+
+        double shift = (nodes[vim].prelim + sim) - (nodes[vip].prelim + sip) + distance;
+        if (shift > 0) {
+            int ancestor = nodes[nodes[vim].ancestor].parent == node.parent ? nodes[vim].ancestor : defaultAncestor;
+            moveSubtree(ancestor, v, shift);
+            sip += shift;
+            sop += shift;
+        }
+        sim += nodes[vim].mod;
+        sip += nodes[vip].mod;
+        som += nodes[vom].mod;
+        sop += nodes[vop].mod;
+    }
+
+    if (nextRight(vim) >= 0 && nextRight(vop) < 0) {
+        nodes[vop].thread = nextRight(vim);
+        nodes[vop].mod += sim - sop;
+    }
+    if (nextLeft(vip) >= 0 && nextLeft(vom) < 0) {
+        nodes[vom].thread = nextLeft(vip);
+        nodes[vom].mod += sip - som;
+        defaultAncestor = v;
+    }
+    return defaultAncestor;
+}
+
+void TreeLayout::moveSubtree(int wl, int wr, double shift) {
+    double subtrees = nodes[wr].number - nodes[wl].number;
+    nodes[wr].change -= shift / subtrees;
+    nodes[wr].shift += shift;
+    nodes[wl].change += shift / subtrees;
+    nodes[wr].prelim += shift;
+    nodes[wr].mod += shift;
+}
+
+// Spreads the shifts recorded by moveSubtree over the children in between
+void TreeLayout::executeShifts(int v) {
+    double shift = 0;
+    double change = 0;
+    const vector<int> &children = nodes[v].children;
+    for (size_t i = children.size(); i-- > 0;) {
+        Node &child = nodes[children[i]];
+        child.prelim += shift;
+        child.mod += shift;
+        change += child.change;
+        shift += child.shift + change;
+    }
+}
+
+void TreeLayout::secondWalk(int v, double m, int depth, double margin) {
+    const Node &node = nodes[v];
+    int index = static_cast<int>(placed.size());
+    int from = node.edgeFrom >= 0 ? nodes[node.edgeFrom].item : -1;
+    bool hidden = node.children.empty() && !node.source->children.empty();
+    placed.push_back({node.source, node.prelim + m, margin + depth * levelHeight, from, node.siblingEdge,
+                      depth, hidden});
+    nodes[v].item = index;
+    for (int child: node.children) {
+        secondWalk(child, m + node.mod, depth + 1, margin);
+    }
+}
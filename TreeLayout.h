@@ -0,0 +1,76 @@
+#ifndef TREELAYOUT_H
+#define TREELAYOUT_H
+
+#include <memory>
+#include <unordered_set>
+#include <vector>
+#include "TreeNode.h"
+
+using namespace std;
+
+// Tidy tree layout (Walker's algorithm in the linear-time form of Buchheim et al.).
+// A node's children are placed on the level below it; the statements of a Seq
+// child sit next to each other on that level and the Seq itself is not drawn. No two
+// subtrees overlap and a parent is centred over its children.
+class TreeLayout {
+public:
+    struct Item {
+        const TreeNode *node;
+        double x;           // left edge
+        double y;           // top edge
+        int from;           // item the incoming edge starts at, -1 for the first top-level statement
+        bool siblingEdge;   // edge comes from the previous statement of the same sequence
+        int depth;
+        bool collapsed;     // the node has children that were left out of the layout
+    };
+
+    TreeLayout(double nodeWidth, double horizontalGap, double levelHeight);
+
+    // Lays out the tree so that the leftmost node starts at x = margin and the root level at y = margin.
+    // The children of nodes in `collapsed` are left out.
+    void compute(const shared_ptr<TreeNode> &root, double margin = 0,
+                 const unordered_set<const TreeNode *> *collapsed = nullptr);
+
+    // Items in preorder: every item comes after the one its edge starts at
+    const vector<Item> &items() const { return placed; }
+    double width() const { return right; }
+    double height() const { return bottom; }
+
+private:
+    struct Node {
+        const TreeNode *source = nullptr;
+        int parent = -1;
+        int number = 0;            // index among the parent's children
+        vector<int> children;
+        int edgeFrom = -1;
+        bool siblingEdge = false;
+        double prelim = 0;
+        double mod = 0;
+        double shift = 0;
+        double change = 0;
+        int thread = -1;
+        int ancestor = -1;
+        int item = -1;             // index in placed
+    };
+
+    double nodeWidth;
+    double distance;
+    double levelHeight;
+    vector<Node> nodes;
+    vector<Item> placed;
+    const unordered_set<const TreeNode *> *collapsed = nullptr;
+    double right = 0;
+    double bottom = 0;
+
+    void addChild(int parent, const shared_ptr<TreeNode> &child);
+    int addNode(int parent, const shared_ptr<TreeNode> &node);
+    int nextLeft(int v) const;
+    int nextRight(int v) const;
+    void firstWalk(int v);
+    int apportion(int v, int defaultAncestor);
+    void moveSubtree(int wl, int wr, double shift);
+    void executeShifts(int v);
+    void secondWalk(int v, double m, int depth, double margin);
+};
+
+#endif // TREELAYOUT_H
@@ -7,15 +7,60 @@
 
 using namespace std;
 
+enum class NodeKind : unsigned char {
+    Seq,    // statement sequence: children are the statements in order
+    If,     // test, then-sequence, optional else-sequence
+    Repeat, // body sequence, test
+    Assign, // value is the variable, child is the expression
+    Read,   // value is the variable
+    Write,  // child is the expression
+    Op,     // op is the operator, children are the operands
+    Const,  // value is the digits
+    Id      // value is the variable
+};
+
+enum class OpKind : unsigned char { None, Less, Equal, Plus, Minus, Mult, Div };
+
+// Label of each kind, as shown in the syntax tree
+inline const char *kindName(NodeKind kind) {
+    static const char *const names[] = {"seq", "if", "repeat", "assign", "read", "write", "op", "Const", "id"};
+    return names[static_cast<int>(kind)];
+}
+
+inline const char *opSymbol(OpKind op) {
+    static const char *const symbols[] = {"", "<", "=", "+", "-", "*", "/"};
+    return symbols[static_cast<int>(op)];
+}
+
+// Operator for a token type such as "PLUS"; None if the token is not an operator
+inline OpKind opFromToken(const string &type) {
+    if (type == "LESSTHAN") return OpKind::Less;
+    if (type == "EQUAL") return OpKind::Equal;
+    if (type == "PLUS") return OpKind::Plus;
+    if (type == "MINUS") return OpKind::Minus;
+    if (type == "MULT") return OpKind::Mult;
+    if (type == "DIV") return OpKind::Div;
+    return OpKind::None;
+}
+
+inline bool isStatement(NodeKind kind) {
+    return kind >= NodeKind::If && kind <= NodeKind::Write;
+}
+
 struct TreeNode {
-    string name;  // Grammar rule or token
-    string value; // Optional value for leaf nodes
+    NodeKind kind;
+    OpKind op = OpKind::None; // Op nodes only
+    string value;             // variable or constant of leaf-like nodes
+    int line = 0;             // source line of the first token, of the operator for Op nodes
+    int untilLine = 0;        // Repeat nodes only: line of the UNTIL keyword
     vector<shared_ptr<TreeNode>> children;
-    vector<shared_ptr<TreeNode>> siblings;
 
-    explicit TreeNode(string name) : name(move(name)) {}
-    TreeNode(string name, string value)
-        : name(move(name)), value(move(value)) {}
+    explicit TreeNode(NodeKind kind) : kind(kind) {}
+    TreeNode(NodeKind kind, string value) : kind(kind), value(move(value)) {}
+    explicit TreeNode(OpKind op) : kind(NodeKind::Op), op(op) {}
+
+    // Text shown under the kind: the operator, variable or constant
+    string label() const { return kind == NodeKind::Op ? opSymbol(op) : value; }
 };
 
 #endif // TREENODE_H
@@ -0,0 +1,60 @@
+#ifndef TREEVISITOR_H
+#define TREEVISITOR_H
+
+#include <type_traits>
+#include "TreeNode.h"
+
+using namespace std;
+
+// Static visitor over the syntax tree. A pass derives from TreeVisitor<Pass, Result>
+// and defines the visitX members it cares about; the switch on the node kind compiles
+// to a jump table and every call is resolved at compile time. Members that are not
+// defined fall back to visitNode, which by default visits the children in order.
+template<typename Derived, typename Result = void>
+class TreeVisitor {
+public:
+    Result visit(const TreeNode &node) {
+        Derived &self = static_cast<Derived &>(*this);
+        switch (node.kind) {
+            case NodeKind::Seq: return self.visitSeq(node);
+            case NodeKind::If: return self.visitIf(node);
+            case NodeKind::Repeat: return self.visitRepeat(node);
+            case NodeKind::Assign: return self.visitAssign(node);
+            case NodeKind::Read: return self.visitRead(node);
+            case NodeKind::Write: return self.visitWrite(node);
+            case NodeKind::Op: return self.visitOp(node);
+            case NodeKind::Const: return self.visitConst(node);
+            case NodeKind::Id: return self.visitId(node);
+        }
+        return self.visitNode(node);
+    }
+
+    Result visitSeq(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitIf(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitRepeat(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitAssign(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitRead(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitWrite(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitOp(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitConst(const TreeNode &node) { return derived().visitNode(node); }
+    Result visitId(const TreeNode &node) { return derived().visitNode(node); }
+
+    Result visitNode(const TreeNode &node) {
+        if constexpr (is_void_v<Result>) {
+            visitChildren(node);
+        } else {
+            return Result{};
+        }
+    }
+
+    void visitChildren(const TreeNode &node) {
+        for (const auto &child: node.children) {
+            if (child) visit(*child);
+        }
+    }
+
+private:
+    Derived &derived() { return static_cast<Derived &>(*this); }
+};
+
+#endif // TREEVISITOR_H
@@ -0,0 +1,196 @@
+#include "VirtualMachine.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+[[noreturn]] void fail(const Instruction &instruction, const string &message) {
+    throw RuntimeError("Runtime error at line " + to_string(instruction.line) + " : " + message);
+}
+
+// Two's complement wrap-around instead of undefined overflow
+inline int64_t wrap(uint64_t value) {
+    return static_cast<int64_t>(value);
+}
+
+// Execution policy that enforces ExecutionLimits. Steps are handed out in slices so
+// the clock is read once per slice instead of once per instruction.
+class Budget {
+public:
+    explicit Budget(const ExecutionLimits &limits)
+        : limits(limits), deadline(chrono::steady_clock::now() + limits.timeout) {
+        nextSlice();
+    }
+
+    void instruction(size_t) {
+        if (fuel == 0) refill();
+        fuel--;
+    }
+
+    void jumpTaken(size_t) {}
+
+    uint64_t steps() const { return used + slice - fuel; }
+
+private:
+    static constexpr uint64_t sliceSize = 4096;
+
+    const ExecutionLimits &limits;
+    chrono::steady_clock::time_point deadline;
+    uint64_t used = 0; // steps of the finished slices
+    uint64_t slice = 0;
+    uint64_t fuel = 0;
+
+    void nextSlice() {
+        slice = limits.maxSteps > 0 ? min(sliceSize, limits.maxSteps - used) : sliceSize;
+        fuel = slice;
+    }
+
+    void refill() {
+        used += slice;
+        slice = fuel = 0;
+        if (limits.maxSteps > 0 && used >= limits.maxSteps) {
+            throw LimitExceeded(false, "Step limit of " + to_string(limits.maxSteps) + " instructions exceeded");
+        }
+        if (limits.timeout.count() > 0 && chrono::steady_clock::now() >= deadline) {
+            auto milliseconds = chrono::duration_cast<chrono::milliseconds>(limits.timeout).count();
+            throw LimitExceeded(true, "Time limit of " + to_string(milliseconds) + " ms exceeded");
+        }
+        nextSlice();
+    }
+};
+
+} // namespace
+
+VirtualMachine::VirtualMachine(const Program &program) : program(program) {}
+
+void VirtualMachine::run(RuntimeInput &in, RuntimeOutput &out) {
+    NoProfiling profiling;
+    execute(in, out, profiling);
+}
+
+void VirtualMachine::run(RuntimeInput &in, RuntimeOutput &out, ExecutionProfile &profile) {
+    StatementProfiler profiler(program);
+    try {
+        execute(in, out, profiler);
+    } catch (const RuntimeError &) {
+        profile = profiler.finish();
+        throw;
+    }
+    profile = profiler.finish();
+}
+
+void VirtualMachine::run(RuntimeInput &in, RuntimeOutput &out, const ExecutionLimits &limits, uint64_t &steps) {
+    Budget budget(limits);
+    try {
+        execute(in, out, budget);
+    } catch (const RuntimeError &) {
+        steps = budget.steps();
+        throw;
+    }
+    steps = budget.steps();
+}
+
+vector<int64_t> VirtualMachine::variables() const {
+    size_t count = min(program.variables.size(), registers.size());
+    return vector<int64_t>(registers.begin(), registers.begin() + static_cast<ptrdiff_t>(count));
+}
+
+template<typename Profiling>
+void VirtualMachine::execute(RuntimeInput &in, RuntimeOutput &out, Profiling &profiling) {
+    registers.assign(static_cast<size_t>(program.registerCount), 0);
+    const Instruction *code = program.code.data();
+    int64_t *r = registers.data();
+    size_t pc = 0;
+
+    while (true) {
+        const Instruction &instruction = code[pc];
+        profiling.instruction(pc);
+        switch (instruction.op) {
+            case OpCode::Const:
+                r[instruction.dst] = instruction.value;
+                break;
+            case OpCode::Move:
+                r[instruction.dst] = r[instruction.a];
+                break;
+            case OpCode::Add:
+                r[instruction.dst] = wrap(static_cast<uint64_t>(r[instruction.a]) + static_cast<uint64_t>(r[instruction.b]));
+                break;
+            case OpCode::Sub:
+                r[instruction.dst] = wrap(static_cast<uint64_t>(r[instruction.a]) - static_cast<uint64_t>(r[instruction.b]));
+                break;
+            case OpCode::Mul:
+                r[instruction.dst] = wrap(static_cast<uint64_t>(r[instruction.a]) * static_cast<uint64_t>(r[instruction.b]));
+                break;
+            case OpCode::Div: {
+                int64_t divisor = r[instruction.b];
+                if (divisor == 0) fail(instruction, "Division by zero");
+                int64_t dividend = r[instruction.a];
+                r[instruction.dst] = divisor == -1 ? wrap(0 - static_cast<uint64_t>(dividend)) : dividend / divisor;
+                break;
+            }
+            case OpCode::AddChecked: {
+                int64_t result = 0; // not written in place: dst may be an operand
+                if (__builtin_add_overflow(r[instruction.a], r[instruction.b], &result)) {
+                    fail(instruction, "Integer overflow");
+                }
+                r[instruction.dst] = result;
+                break;
+            }
+            case OpCode::SubChecked: {
+                int64_t result = 0; // not written in place: dst may be an operand
+                if (__builtin_sub_overflow(r[instruction.a], r[instruction.b], &result)) {
+                    fail(instruction, "Integer overflow");
+                }
+                r[instruction.dst] = result;
+                break;
+            }
+            case OpCode::MulChecked: {
+                int64_t result = 0; // not written in place: dst may be an operand
+                if (__builtin_mul_overflow(r[instruction.a], r[instruction.b], &result)) {
+                    fail(instruction, "Integer overflow");
+                }
+                r[instruction.dst] = result;
+                break;
+            }
+            case OpCode::DivChecked: {
+                int64_t divisor = r[instruction.b];
+                if (divisor == 0) fail(instruction, "Division by zero");
+                int64_t dividend = r[instruction.a];
+                if (divisor == -1 && dividend == INT64_MIN) fail(instruction, "Integer overflow");
+                r[instruction.dst] = dividend / divisor;
+                break;
+            }
+            case OpCode::DivUnchecked:
+                r[instruction.dst] = r[instruction.a] / r[instruction.b];
+                break;
+            case OpCode::Less:
+                r[instruction.dst] = r[instruction.a] < r[instruction.b];
+                break;
+            case OpCode::Equal:
+                r[instruction.dst] = r[instruction.a] == r[instruction.b];
+                break;
+            case OpCode::Read:
+                if (!in.next(r[instruction.dst])) {
+                    fail(instruction, "Expected an integer to read into \"" + program.variables[instruction.dst] + "\"");
+                }
+                break;
+            case OpCode::Write:
+                out.write(r[instruction.a]);
+                break;
+            case OpCode::Jump:
+                pc = static_cast<size_t>(instruction.target);
+                continue;
+            case OpCode::JumpIfFalse:
+                if (r[instruction.a] == 0) {
+                    profiling.jumpTaken(pc);
+                    pc = static_cast<size_t>(instruction.target);
+                    continue;
+                }
+                break;
+            case OpCode::Halt:
+                return;
+        }
+        pc++;
+    }
+}
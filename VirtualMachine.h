@@ -0,0 +1,56 @@
+#ifndef VIRTUALMACHINE_H
+#define VIRTUALMACHINE_H
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "CodeGenerator.h"
+#include "Profiler.h"
+#include "RuntimeIO.h"
+
+using namespace std;
+
+// Thrown for errors of the running program: "Runtime error at line N : ..."
+struct RuntimeError : runtime_error {
+    using runtime_error::runtime_error;
+};
+
+struct ExecutionLimits {
+    uint64_t maxSteps = 0;          // instructions per run, 0 for no limit
+    chrono::nanoseconds timeout{0}; // wall clock per run, 0 for no limit
+};
+
+// Thrown when a run goes over its ExecutionLimits
+struct LimitExceeded : RuntimeError {
+    bool timedOut; // false when the step budget ran out
+    LimitExceeded(bool timedOut, const string &message) : RuntimeError(message), timedOut(timedOut) {}
+};
+
+// Interprets a compiled Program; read and write statements go through the runtime I/O layer
+class VirtualMachine {
+public:
+    explicit VirtualMachine(const Program &program);
+
+    void run(RuntimeInput &in, RuntimeOutput &out);
+
+    // Same, counting every instruction and timing every statement. The profile
+    // is filled in even when the program stops with a RuntimeError.
+    void run(RuntimeInput &in, RuntimeOutput &out, ExecutionProfile &profile);
+
+    // Same, stopping with LimitExceeded once a limit is reached. `steps` receives
+    // the number of instructions executed, also when an exception is thrown.
+    void run(RuntimeInput &in, RuntimeOutput &out, const ExecutionLimits &limits, uint64_t &steps);
+
+    // Variable values after the last run, in Program::variables order
+    vector<int64_t> variables() const;
+
+private:
+    const Program &program;
+    vector<int64_t> registers;
+
+    template<typename Profiling>
+    void execute(RuntimeInput &in, RuntimeOutput &out, Profiling &profiling);
+};
+
+#endif // VIRTUALMACHINE_H
@@ -0,0 +1,75 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct WorkQueue {
+    mutex lock;
+    deque<size_t> tasks;
+};
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount) : threadCount(threadCount) {
+    if (this->threadCount == 0) this->threadCount = max(1u, thread::hardware_concurrency());
+}
+
+void WorkStealingPool::run(size_t count, const function<void(size_t)> &task) {
+    size_t workers = min<size_t>(threadCount, count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    // Contiguous shares keep related tasks (e.g. one program's test cases) together
+    vector<unique_ptr<WorkQueue>> queues;
+    for (size_t w = 0; w < workers; ++w) {
+        queues.push_back(make_unique<WorkQueue>());
+        for (size_t i = count * w / workers; i < count * (w + 1) / workers; ++i) {
+            queues[w]->tasks.push_back(i);
+        }
+    }
+
+    auto work = [&](size_t self) {
+        while (true) {
+            size_t index = 0;
+            bool found = false;
+            {
+                lock_guard<mutex> guard(queues[self]->lock);
+                if (!queues[self]->tasks.empty()) {
+                    index = queues[self]->tasks.back();
+                    queues[self]->tasks.pop_back();
+                    found = true;
+                }
+            }
+            for (size_t k = 1; !found && k < workers; ++k) {
+                WorkQueue &victim = *queues[(self + k) % workers];
+                lock_guard<mutex> guard(victim.lock);
+                if (!victim.tasks.empty()) {
+                    index = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    found = true;
+                }
+            }
+            // Nothing is ever added back, so empty queues everywhere means done
+            if (!found) return;
+            task(index);
+        }
+    };
+
+    vector<thread> pool;
+    for (size_t w = 1; w < workers; ++w) {
+        pool.emplace_back(work, w);
+    }
+    work(0);
+    for (thread &worker: pool) {
+        worker.join();
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+// Runs a batch of independent tasks on all cores. Every worker starts with an even
+// share of the task indices in its own deque and takes from the back of it; a worker
+// that runs dry steals from the front of another's, so a few slow tasks do not leave
+// the other cores idle.
+class WorkStealingPool {
+public:
+    // threadCount 0 uses one thread per hardware core
+    explicit WorkStealingPool(unsigned threadCount = 0);
+
+    // Calls task(i) for every i in [0, count) and returns when all have finished.
+    // Tasks must not throw.
+    void run(size_t count, const function<void(size_t)> &task);
+
+    unsigned threads() const { return threadCount; }
+
+private:
+    unsigned threadCount;
+};
+
+#endif // WORKSTEALINGPOOL_H
@@ -1,5 +1,6 @@
 #include "operation_window.h"
 #include "ui_operation_window.h"
+#include <algorithm>
 #include <fstream>
 #include <vector>
 #include <string>
@@ -7,22 +8,109 @@
 #include <QTextStream>
 #include <QFileInfo>
 #include <QMessageBox>
+#include <QStringList>
+#include <QtConcurrent>
+#include <atomic>
 #include "Token.h"
-#include "Scanner.h"
+#include "CompilationSession.h"
 #include "Parser.h"
+#include "SemanticAnalyzer.h"
 #include "DrawTree.h"
 #include "TreeDraw.h"
 
+// Progress and cancellation shared between the UI thread and the compile worker
+struct CompileJob
+{
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> parsing{false};
+    std::atomic<int> scanPermille{0};
+    std::atomic<size_t> tokenCount{0};
+    ParseMonitor monitor;
+    quint64 version = 0; // session version the job compiles
+};
+
+struct CompileResult
+{
+    std::shared_ptr<const std::vector<Token>> tokens; // set when the worker scanned them
+    std::shared_ptr<TreeNode> syntaxTree;
+    QStringList issues; // semantic errors and warnings
+    QString error;
+    bool cancelled = false;
+};
+
+namespace
+{
+// Parses the session's tokens, scanning the source first (and writing the token
+// file) when they are not cached yet; runs on a worker thread
+CompileResult compileFile(std::shared_ptr<const std::string> source, std::shared_ptr<const std::vector<Token>> tokens,
+                          const std::string &tokenPath, std::shared_ptr<CompileJob> job)
+{
+    CompileResult result;
+    try
+    {
+        if (!tokens)
+        {
+            auto scanned = std::make_shared<std::vector<Token>>();
+            bool finished = scanSource(*source, *scanned, [&](int permille) {
+                job->scanPermille = permille;
+                return !job->cancelled;
+            });
+            if (!finished)
+            {
+                result.cancelled = true;
+                return result;
+            }
+            if (!writeTokenFile(tokenPath, *scanned))
+            {
+                result.error = "Failed to open input or output file.";
+                return result;
+            }
+            tokens = scanned;
+            result.tokens = tokens;
+        }
+
+        job->tokenCount = tokens->size();
+        job->parsing = true;
+        Parser parser(*tokens);
+        parser.setMonitor(&job->monitor);
+        result.syntaxTree = parser.parse();
+        for (const SemanticIssue &issue : checkSemantics(*result.syntaxTree))
+            result.issues << QString::fromStdString(issue.message);
+    }
+    catch (const ParseCancelled &)
+    {
+        result.cancelled = true;
+    }
+    catch (const std::exception &e)
+    {
+        result.error = e.what();
+    }
+    return result;
+}
+}
+
 operation_window::operation_window(const QString &filePath, QWidget *parent)
-    : QWidget(parent), filePath(filePath), ui(new Ui::operation_window)
+    : QWidget(parent), filePath(filePath), ui(new Ui::operation_window),
+      watcher(new QFutureWatcher<CompileResult>(this)), session(new CompilationSession(filePath, this))
 {
     ui->setupUi(this);
+    ui->progressBar->hide();
+    ui->cancelButton->hide();
+
+    connect(watcher, &QFutureWatcher<CompileResult>::finished, this, &operation_window::compileFinished);
+    connect(&progressTimer, &QTimer::timeout, this, &operation_window::updateProgress);
 
     this->setWindowState(Qt::WindowFullScreen);
 }
 
 operation_window::~operation_window()
 {
+    if (job)
+    {
+        job->cancelled = true;
+        job->monitor.cancelled = true;
+        watcher->waitForFinished();
+    }
     delete ui;
 }
 
@@ -33,109 +121,135 @@ void operation_window::on_pushButton_clicked()
         QMessageBox::warning(this, "Error", "No file selected.");
         return;
     }
+    if (job)
+        return; // the running parse may be writing the token file
 
-    QFile inputFile(filePath);
-    if (!inputFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    // Served from the session when the file has not changed since the last scan
+    QString error;
+    if (!session->refresh(error) || !session->scan(error))
     {
-        QMessageBox::warning(this, "Error", "Failed to open input file.");
+        QMessageBox::warning(this, "Error", error);
         return;
     }
 
-    QFileInfo fileInfo(filePath);
-    QString outputFilePath = fileInfo.path() + "/token_file.txt";
+    QMessageBox::information(this, "Success", "Tokens successfully written to:\n" + session->tokenFilePath());
+}
 
-    std::ifstream inFile(filePath.toStdString());
-    std::ofstream outFile(outputFilePath.toStdString());
-    if (!outFile.is_open())
+void operation_window::on_pushButton_2_clicked()
+{
+    if (filePath.isEmpty())
     {
-        QMessageBox::warning(this, "Error", "Failed to create output file.");
+        QMessageBox::warning(this, "Error", "No file selected.");
         return;
     }
+    if (job)
+        return; // a parse is already running
 
-    int lineCount = 1;
-    std::string line;
-    std::vector<Token> outputTokens;
-
-    while (std::getline(inFile, line))
+    QString error;
+    if (!session->refresh(error))
     {
-        std::vector<Token> tokens = tokenize(line, lineCount);
-        outputTokens.insert(outputTokens.end(), tokens.begin(), tokens.end());
-        lineCount++;
+        QMessageBox::warning(this, "Error", error);
+        return;
     }
-
-    // Write tokens to the output file
-    for (const Token &token : outputTokens)
+    if (session->syntaxTree())
     {
-        outFile << token.value << "," << token.type << "\n";
+        showSyntaxTree(session->syntaxTree(), session->issues());
+        return;
     }
 
-    outFile.close();
-    inFile.close();
+    // Scan (unless the Scan button already did) and parse on a worker thread; only
+    // the finished tree comes back to the UI thread
+    job = std::make_shared<CompileJob>();
+    job->version = session->version();
+    watcher->setFuture(QtConcurrent::run(compileFile, session->source(), session->tokens(),
+                                         session->tokenFilePath().toStdString(), job));
+
+    ui->pushButton->setEnabled(false);
+    ui->pushButton_2->setEnabled(false);
+    ui->progressBar->setValue(0);
+    ui->progressBar->setFormat("Scanning %p%");
+    ui->progressBar->show();
+    ui->cancelButton->show();
+    progressTimer.start(50);
+}
+
+void operation_window::on_cancelButton_clicked()
+{
+    if (!job)
+        return;
+    job->cancelled = true;
+    job->monitor.cancelled = true;
+}
+
+void operation_window::updateProgress()
+{
+    if (!job)
+        return;
 
-    QMessageBox::information(this, "Success", "Tokens successfully written to:\n" + outputFilePath);
+    // Scanning fills the first half of the bar, parsing the second
+    int permille = job->scanPermille / 2;
+    if (job->parsing)
+    {
+        size_t tokenCount = job->tokenCount;
+        size_t position = job->monitor.position.load(std::memory_order_relaxed);
+        permille = 500 + (tokenCount > 0 ? static_cast<int>(position * 500 / tokenCount) : 500);
+        ui->progressBar->setFormat("Parsing %p%");
+    }
+    ui->progressBar->setValue(permille / 10);
 }
 
-void operation_window::on_pushButton_2_clicked()
+void operation_window::compileFinished()
 {
-    if (filePath.isEmpty())
+    progressTimer.stop();
+    quint64 version = job->version;
+    job.reset();
+    ui->progressBar->hide();
+    ui->cancelButton->hide();
+    ui->pushButton->setEnabled(true);
+    ui->pushButton_2->setEnabled(true);
+
+    CompileResult result = watcher->result();
+    if (result.tokens)
+        session->storeTokens(version, result.tokens);
+    if (result.cancelled)
     {
-        QMessageBox::warning(this, "Error", "No file selected.");
+        QMessageBox::information(this, "Cancelled", "Parsing was cancelled.");
         return;
     }
-
-    QFile inputFile(filePath);
-    if (!inputFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (version != session->version())
     {
-        QMessageBox::warning(this, "Error", "Failed to open input file.");
+        // The file changed during the parse: parse the new text rather than show the old one
+        on_pushButton_2_clicked();
         return;
     }
-
-    QFileInfo fileInfo(filePath);
-    QString outputFilePath = fileInfo.path() + "/token_file.txt";
-
-    try
+    if (!result.error.isEmpty())
     {
-        std::ifstream inFile(filePath.toStdString());
-        std::ofstream outFile(outputFilePath.toStdString());
-        if (!outFile.is_open())
-        {
-            QMessageBox::warning(this, "Error", "Failed to create output file.");
-            return;
-        }
-
-        int lineCount = 1;
-        std::string line;
-        std::vector<Token> outputTokens;
-
-        while (std::getline(inFile, line))
-        {
-            std::vector<Token> tokens = tokenize(line, lineCount);
-            outputTokens.insert(outputTokens.end(), tokens.begin(), tokens.end());
-            lineCount++;
-        }
-
-        // Write tokens to the output file
-        for (const Token &token : outputTokens)
-        {
-            outFile << token.value << "," << token.type << "\n";
-        }
+        QMessageBox::critical(this, "Error", result.error);
+        return;
+    }
 
-        Parser parser(outputTokens);
-        auto syntaxTree = parser.parse();
+    session->storeSyntaxTree(version, result.syntaxTree, result.issues);
+    showSyntaxTree(result.syntaxTree, result.issues);
+}
 
-        // Draw the syntax tree
-        TreeDraw *treeDraw = new TreeDraw(this);
-        treeDraw->drawSyntaxTree(syntaxTree);
-        treeDraw->show();
+void operation_window::showSyntaxTree(const std::shared_ptr<TreeNode> &syntaxTree, const QStringList &issues)
+{
+    // Draw the syntax tree; after a re-parse only what changed moves
+    if (!treeDraw)
+        treeDraw = new TreeDraw(this);
+    treeDraw->drawSyntaxTree(syntaxTree);
+    treeDraw->show();
 
-        QMessageBox::information(this, "Success", "Syntax tree drawn successfully and tokens saved.");
-    }
-    catch (const std::exception &e)
+    if (!issues.isEmpty())
     {
-        QMessageBox::critical(this, "Error", e.what());
-    }
-    catch (...)
-    {
-        QMessageBox::critical(this, "Error", "An unknown error occurred.");
+        // Long lists would not fit the box; the first ones are what matters
+        const int shown = 20;
+        QStringList lines = issues.mid(0, shown);
+        if (issues.size() > shown)
+            lines << QString("... and %1 more").arg(issues.size() - shown);
+        QMessageBox::warning(this, "Semantic analysis", lines.join("\n"));
+        return;
     }
+
+    QMessageBox::information(this, "Success", "Syntax tree drawn successfully and tokens saved.");
 }
@@ -2,11 +2,21 @@
 #define OPERATION_WINDOW_H
 
 #include <QWidget>
+#include <QFutureWatcher>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
 
 namespace Ui {
 class operation_window;
 }
 
+struct CompileJob;
+struct CompileResult;
+class TreeDraw;
+class CompilationSession;
+struct TreeNode;
+
 class operation_window : public QWidget
 {
     Q_OBJECT
@@ -21,11 +31,22 @@ private slots:
 
     void on_pushButton_2_clicked();
 
+    void on_cancelButton_clicked();
+
+    void updateProgress();
+
+    void compileFinished();
+
 private:
+    void showSyntaxTree(const std::shared_ptr<TreeNode> &syntaxTree, const QStringList &issues);
+
     QString filePath;
     Ui::operation_window *ui;
+    std::shared_ptr<CompileJob> job; // the running parse, shared with its worker thread
+    QFutureWatcher<CompileResult> *watcher;
+    QTimer progressTimer;
+    TreeDraw *treeDraw = nullptr; // reused by every parse, so the drawing updates in place
+    CompilationSession *session;  // the file's text, tokens and tree, shared by both buttons
 };
 
 #endif // OPERATION_WINDOW_H
-
-